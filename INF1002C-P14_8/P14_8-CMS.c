@@ -1,42 +1,449 @@
+#define _DEFAULT_SOURCE // POSIX and BSD declarations (madvise, open_memstream, strcasecmp) also under -std=c11
 #include <stdio.h>  // Standard I/O library
 #include <ctype.h>  // Char classification and conversion library (e.g., isalpha, tolower)
 #include <string.h> // String manipulation functions (e.g., strcmp)
 #include <stdlib.h> // Program control, memory management, and basic utilities
 #include <math.h>   // Math functions
+#include <limits.h> // INT_MAX
+#include <stdint.h> // Fixed-width words for scan bitmaps
+#include <time.h>   // Clock for scan kernel benchmark
+#include <pthread.h> // Worker threads for parallel loading
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_SIMD 1 // SSE2/AVX2 scan kernels, chosen at run time by CPU support
+#include <immintrin.h>
+#endif
+#ifdef _WIN32
+#include <io.h>     // Windows has no mmap, database file is read into memory instead
+#include <windows.h> // MoveFileEx for replacing database file on save
+#else
+#include <fcntl.h>    // File open flags for mmap loader
+#include <sys/mman.h> // Memory-mapped file access
+#include <sys/stat.h> // File size lookup
+#include <unistd.h>   // POSIX close, fsync
+#endif
+#ifdef __linux__
+#define SERVER_MODE 1 // "--serve" event loop needs epoll
+#include <errno.h>      // EAGAIN and EINTR from non-blocking socket calls
+#include <signal.h>     // Stop server cleanly on SIGINT/SIGTERM
+#include <sys/epoll.h>  // Readiness notification for all client sockets in one thread
+#include <sys/socket.h>
+#include <sys/un.h>     // Unix domain socket address
+#endif
 
 #define FILE_NAME "P14_8-CMS.txt"
+#define TEMP_FILE_NAME "P14_8-CMS.txt.tmp" // Save writes here first, then renames over FILE_NAME
+#define SAVE_BUFFER_SIZE (1 << 20) // Bytes of formatted records collected before each write
+#define TABLE_ROW_MAX 128 // Longest record row of the SHOW ALL table, including newline
+#define PAGE_SIZE_DEFAULT 20 // Records per page of SHOW PAGES
+#define PAGE_SIZE_MAX 1000
+#define WAL_FILE_NAME "P14_8-CMS.txt.wal" // Write-ahead log of changes not yet saved into FILE_NAME
+#define WAL_GROUP_COMMIT_RECORDS 256 // Logged changes sharing one fsync before a commit is forced
+#define SNAPSHOT_FILE_NAME "P14_8-CMS.bin" // Binary snapshot of the database, FILE_NAME stays the interchange format
+#define SNAPSHOT_TEMP_FILE_NAME "P14_8-CMS.bin.tmp"
+#define SNAPSHOT_MAGIC "P148CMS" // First 8 bytes of a snapshot file (including null terminator)
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_SIZE 24 // Magic, version, record count, programme count, reserved
 #define DB_NAME "StudentRecords"
 #define MAX_ID_LEN 7
 #define MAX_NAME_LEN 30
 #define MAX_PROGRAMME_LEN 50
 #define FILE_HEADER_LINES 5
+#define LOAD_CHUNKS_PER_THREAD 4 // Chunks per worker thread so faster threads pick up remaining work
+#define LOAD_MIN_CHUNK_BYTES 65536 // Smaller chunks are not worth a thread hand-off
+#define TABLE_FIRST_SEGMENT 1024 // Record slots in first table segment, each later segment doubles in size
+#define TABLE_MAX_SEGMENTS 21 // Enough segments for over 2 billion record slots
+#define MARKS_BUCKETS 1001 // One marks index bucket per tenth of a mark from 0.0 to 100.0
+#define ID_DIGITS_LEN 8 // Bytes per ID in the ID digits column: up to 7 digits, null padded
+#define SCAN_BENCH_ROWS 1000000 // Default rows for "--bench-scan"
+#define ID_INDEX_SHARD_BITS 6 // ID index is split into 1 << ID_INDEX_SHARD_BITS independently locked shards
+#define ID_INDEX_SHARDS (1 << ID_INDEX_SHARD_BITS)
+#define ID_BENCH_THREADS 16 // Default highest thread count for "--bench-id-index"
+#define ID_BENCH_POOL 4096 // IDs each benchmark thread inserts and deletes
+#define ID_BENCH_OPS 1000000 // Operations per benchmark thread
+#define BATCH_LINE_LEN 512 // Longest batch command or import line, including newline
+#define IMPORT_FILE_NAME_LEN 255 // Longest CSV file name accepted by IMPORT
+#define STORE_MAX_READERS 64 // Threads that can hold a snapshot of the record store at the same time
+#define STRESS_SEED_RECORDS 10000 // Records in the store when "--stress-mvcc" starts its threads
+#define SERVER_MAX_EVENTS 64 // Socket events handled per wake-up of the server event loop
+#define SERVER_MAX_OUTPUT (256 * 1024 * 1024) // Most unsent response bytes held for one client, a client that stops reading is dropped
+#define SORT_PARALLEL_MIN 65536 // Fewer records are sorted on the calling thread
+#define SORT_MAX_THREADS 64
+#define SORTED_BLOCK_SIZE 512 // Most nodes in one block of a sorted order, bounds the nodes an insert or delete moves
+#define SCAN_PARALLEL_MIN 65536 // Smaller record tables are scanned on the calling thread
+#define SCAN_MAX_THREADS 64
+#define QUERY_MAX_TERMS 32 // Conditions and AND/OR/NOT operators in one WHERE query
+#define QUERY_INPUT_LEN 512 // Longest WHERE query typed at the prompt
+#define QUERY_CACHE_ENTRIES 64 // Name and programme lookups remembered by the query cache
+#define QUERY_CACHE_MAX_BYTES (4 << 20) // Least recently used lookups are dropped beyond this many bytes
+#define NAME_GRAM_LEN 3 // Name index is keyed on trigrams, shorter queries scan the linked list
 
-// Structure representing student node in the linked list
-typedef struct student_node {
+// Grade codes in descending order, GRADE_NAMES holds the display text of each code
+typedef enum grade {
+    GRADE_A_PLUS, GRADE_A, GRADE_A_MINUS,
+    GRADE_B_PLUS, GRADE_B, GRADE_B_MINUS,
+    GRADE_C_PLUS, GRADE_C,
+    GRADE_D_PLUS, GRADE_D,
+    GRADE_F,
+    GRADE_COUNT
+} GRADE;
+
+// Columns a listing can be sorted by, each with its own sorted order
+typedef enum sort_column {
+    SORT_BY_ID, SORT_BY_NAME, SORT_BY_PROGRAMME, SORT_BY_MARKS,
+    SORT_COLUMN_COUNT
+} SORT_COLUMN;
+
+// Column tested by a condition of a WHERE query, QUERY_FIELD_NAMES holds the keyword of each
+typedef enum query_field {
+    QUERY_ID, QUERY_NAME, QUERY_PROGRAMME, QUERY_MARKS, QUERY_GRADE,
+    QUERY_FIELD_COUNT
+} QUERY_FIELD;
+
+// Comparison of a WHERE query condition, QUERY_OP_NAMES holds the text of each
+typedef enum query_op {
+    QUERY_NE, QUERY_LE, QUERY_GE, QUERY_EQ, QUERY_LT, QUERY_GT, QUERY_CONTAINS,
+    QUERY_OP_COUNT
+} QUERY_OP;
+
+// Way of finding the candidate records of a WHERE query, QUERY_ACCESS_NAMES holds the EXPLAIN text of each
+typedef enum query_access {
+    ACCESS_FULL_SCAN, ACCESS_ID_INDEX, ACCESS_ID_SUFFIX, ACCESS_NAME_INDEX, ACCESS_GRADE_BUCKETS, ACCESS_MARKS_INDEX,
+    ACCESS_COUNT
+} QUERY_ACCESS;
+
+// Student record fields as parsed from a file, before the programme is interned
+typedef struct student_record {
     int id;
     char name[MAX_NAME_LEN + 1];           // +1 for null terminator
     char programme[MAX_PROGRAMME_LEN + 1]; // +1 for null terminator
     float marks;
     char grade[3]; // +1 for null terminator, +1 for (+/-) symbols
+} STUDENT_RECORD;
+
+// Structure representing student node in the linked list
+typedef struct student_node {
+    int id;
+    char name[MAX_NAME_LEN + 1];           // +1 for null terminator
+    unsigned short programme_code; // Code of programme name in programme dictionary, use programme_name() to display
+    unsigned char grade; // GRADE code calculated from marks, use grade_name() to display
+    float marks;
     struct student_node* next;
+    struct student_node* prev; // Allows unlinking a node found through the ID index without a scan
+    int slot; // Position of node in the record table
+    int grade_pos; // Position of node in the bucket of its grade
+    int marks_pos; // Position of node in the marks index bucket of its marks
+    unsigned int seq; // Insertion order, recycled slots do not follow list order so scans sort by this
+    // Versions of the record store (see STORE) for snapshot readers, all changed under write_seq
+    unsigned int write_seq; // Odd while a writer changes the node, readers retry copies that overlap a change
+    unsigned int created_version; // Version that inserted the node
+    unsigned int deleted_version; // Version that deleted the node, 0 while live
+    unsigned int fields_version; // Version that wrote the current name, programme, grade and marks
+    struct record_version* older; // Field values before fields_version, newest first
 } STUDENT_NODE;
 
+// Field values a node held before an update, kept while a snapshot reader may still need them
+typedef struct record_version {
+    char name[MAX_NAME_LEN + 1];
+    unsigned short programme_code;
+    unsigned char grade;
+    float marks;
+    unsigned int fields_version; // Version that wrote these values, they were replaced at end_version
+    unsigned int end_version;
+    struct record_version* older; // Links to versions already freed are never followed (see store_read_node)
+    struct record_version* next_retired; // Replaced versions in end_version order, freed once no snapshot needs them
+} RECORD_VERSION;
+
+// Multi-version record store: one writer at a time under write_lock, any number of lock-free snapshot readers
+// Every write_lock section is one transaction stamped with pending_version and published by store_write_end,
+// readers see the nodes and field values of the last published version for as long as they hold their snapshot
+typedef struct store {
+    pthread_mutex_t write_lock;
+    uint64_t committed; // Last published version << 32 | records in that version, read and written atomically
+    unsigned int pending_version; // Version of the transaction holding write_lock
+    unsigned int readers[STORE_MAX_READERS]; // Snapshot version held by each reader, 0 for a free entry
+    STUDENT_NODE* retired_nodes; // Deleted nodes in deleted_version order, chained through next until released
+    STUDENT_NODE* retired_nodes_tail;
+    RECORD_VERSION* retired_versions; // Replaced field values in end_version order
+    RECORD_VERSION* retired_versions_tail;
+} STORE;
+
+// Snapshot held by one reader thread
+typedef struct store_reader {
+    int entry; // Position in STORE readers
+    unsigned int version;
+    int count; // Records visible in the snapshot
+} STORE_READER;
+
+// Segment of the record table: contiguous rows plus the ID digits column scanned by ID queries
+// Both arrays are carved out of one allocation starting at nodes
+typedef struct record_segment {
+    STUDENT_NODE* nodes; // Row storage, linked list nodes live here instead of individual mallocs
+    char* id_digits; // ID_DIGITS_LEN bytes per slot: decimal digits of nodes[i].id, all zero for an empty slot
+} RECORD_SEGMENT;
+
+// Record table acting as an arena for all nodes of the open database
+// Grows by adding segments so existing nodes never move and list pointers stay valid
+typedef struct record_table {
+    RECORD_SEGMENT segments[TABLE_MAX_SEGMENTS];
+    int segment_count; // Number of allocated segments
+    int used; // Slots handed out so far (high-water mark)
+    STUDENT_NODE* free_list; // Deleted slots waiting to be recycled, chained through next
+    int free_count; // Number of slots in free list
+    unsigned int next_seq; // Insertion order given to next allocated node
+    size_t bytes_reserved; // Bytes allocated for all segments
+} RECORD_TABLE;
+
+// One part of the ID index, an open-addressing (linear probing) hash table with its own lock
+typedef struct id_index_shard {
+    pthread_mutex_t lock; // Held for every lookup and change, threads working on other shards never wait
+    STUDENT_NODE** slots; // Table of node pointers, NULL marks an empty slot
+    int capacity; // Number of slots, always a power of two
+    int count; // Number of occupied slots
+    char padding[64]; // Keeps locks of neighbouring shards off the same cache line
+} ID_INDEX_SHARD;
+
+// Hash index mapping student ID to its node in the linked list, sharded by the top bits of the ID hash
+// Lookups need only their shard lock, but INSERT and DELETE also change the list and other indexes under the store
+// write lock, so writers on different IDs still run one at a time (only --bench-id-index uses the shards in parallel)
+typedef struct id_index {
+    ID_INDEX_SHARD shards[ID_INDEX_SHARDS];
+} ID_INDEX;
+
+// Parsed line of a database file chunk, produced by a load worker thread
+typedef struct load_entry {
+    STUDENT_RECORD record; // Parsed fields, only valid when is_valid is set
+    int line_offset; // Line number relative to start of chunk, used for error reporting
+    int is_valid; // 0 if line is malformed
+} LOAD_ENTRY;
+
+// Newline-aligned slice of the database file body parsed by one worker thread
+typedef struct load_chunk {
+    const char* start;
+    const char* end;
+    LOAD_ENTRY* entries; // Parsed lines in file order (blank lines are skipped)
+    int entry_count;
+    int line_count; // Lines in chunk, summed up to find first line number of next chunk
+    int is_failed; // Set on memory allocation failure
+} LOAD_CHUNK;
+
+// Work queue shared by load worker threads
+typedef struct load_job {
+    LOAD_CHUNK* chunks;
+    int chunk_count;
+    int next_chunk; // Next chunk to hand out, protected by lock
+    pthread_mutex_t lock;
+} LOAD_JOB;
+
+// Write-ahead log: changes are buffered here and flushed to WAL_FILE_NAME with one fsync per group commit
+typedef struct wal {
+    FILE* file; // Log opened for appending, NULL if write-ahead logging is unavailable
+    char* buffer; // Formatted log records waiting for next commit
+    size_t length; // Bytes used in buffer
+    int pending; // Records in buffer
+    int logged; // Records committed to log since last compaction
+} WAL;
+
+// String dictionary assigning small integer codes to repeated strings
+typedef struct string_dict {
+    char** strings; // Code -> string
+    int count; // Number of strings (next code to hand out)
+    int capacity; // Allocated entries in strings
+    int* slots; // Open-addressing hash table of code + 1, 0 marks an empty slot
+    int slot_capacity; // Always a power of two
+} STRING_DICT;
+
+// Unordered set of nodes sharing one grade or marks value
+// Nodes remember their position in each bucket so removal is a swap with the last entry
+typedef struct node_bucket {
+    STUDENT_NODE** nodes;
+    int count;
+    int capacity;
+} NODE_BUCKET;
+
+// Suffix array over the ID digits column: every suffix of every indexed ID, sorted, for substring ID search
+// IDs inserted since the build wait in pending and are scanned, deleted IDs are masked out by is_indexed
+typedef struct id_suffix_index {
+    uint64_t* entries; // Packed suffix key << 32 | slot, sorted (see id_suffix_key)
+    int count; // Entries in suffix array
+    unsigned char* is_indexed; // Per slot up to indexed_slots: 1 while the suffixes of the slot ID are valid
+    int indexed_slots;
+    int* pending; // Slots appended since the build
+    int pending_count;
+    int pending_capacity;
+    int deleted; // Entries masked out by deletes
+    int is_built; // 0 until built at open, ID queries scan the ID digits column while unbuilt
+} ID_SUFFIX_INDEX;
+
+// Run of consecutive nodes of a sorted order
+typedef struct sorted_block {
+    int count;
+    STUDENT_NODE* nodes[SORTED_BLOCK_SIZE];
+} SORTED_BLOCK;
+
+// Permutation of all linked nodes sorted by one column, kept sorted as records are inserted, updated and deleted
+// Ties are ordered by insertion order, so every node has exactly one position, found by binary search
+// Nodes are split into blocks so a change only moves nodes within one block, not the whole permutation
+typedef struct sorted_order {
+    SORTED_BLOCK** blocks; // Non-empty blocks in key order
+    int block_count;
+    int block_capacity;
+    int count; // Nodes in all blocks
+    int is_built; // 0 until built at open or after an allocation failure, built again on next sorted listing
+} SORTED_ORDER;
+
+// Running aggregates of the records in one programme, updated as records are inserted, updated and deleted
+typedef struct programme_stats {
+    int count;
+    double sum; // Sum of marks
+    double sum_squares; // Sum of squared marks, for the standard deviation
+    int grade_counts[GRADE_COUNT];
+    int* marks_counts; // MARKS_BUCKETS entries: records per tenth of a mark, for min, max, median and percentiles
+} PROGRAMME_STATS;
+
+// Aggregates of every programme, indexed by programme code
+typedef struct stats_table {
+    PROGRAMME_STATS* programmes;
+    int capacity; // Entries in programmes, codes at or above it have no records yet
+    int is_built; // 0 after an allocation failure until STATS rebuilds the table from the linked list
+} STATS_TABLE;
+
+// Part of a parallel sort handed to one thread: sort nodes[start, end) or merge its halves [start, mid) and [mid, end)
+typedef struct sort_job {
+    STUDENT_NODE** from;
+    STUDENT_NODE** to; // Merge output, unused when sorting
+    int start;
+    int mid;
+    int end;
+    int (*compare)(const void* a, const void* b);
+} SORT_JOB;
+
+// Slot range of the record table evaluated by one parallel scan worker
+typedef struct scan_job {
+    const STORE_READER* reader; // Snapshot whose nodes and field values are scanned
+    int (*predicate)(const STUDENT_NODE* node, const void* context);
+    const void* context; // Passed to predicate with the snapshot copy of every node in the snapshot
+    int start; // First slot of the range
+    int end; // One past last slot of the range
+    STUDENT_NODE** matches; // Room for end - start matching nodes, in slot order
+    int match_count;
+} SCAN_JOB;
+
+// Node of a parsed WHERE query: a condition on one column, or AND/OR/NOT over other terms
+typedef struct query_term {
+    char type; // 'T' for a condition, '&' AND, '|' OR, '!' NOT
+    QUERY_FIELD field;
+    QUERY_OP op;
+    int left, right; // Operand terms of AND and OR, NOT uses left only
+    double number; // Student ID, marks or grade code compared against
+    int grade_first, grade_last; // Grade codes named by the condition, a single letter names its whole family
+    char text[MAX_PROGRAMME_LEN + 1]; // Lowercase name or programme keyword, or ID digits for CONTAINS
+    char* is_code_matched; // Programme conditions: flag per dictionary code, filled once per query
+} QUERY_TERM;
+
+// Parsed WHERE query, terms[root] is the whole condition
+typedef struct query {
+    QUERY_TERM terms[QUERY_MAX_TERMS];
+    int count;
+    int root;
+} QUERY;
+
+// Access path the planner considered for a WHERE query, with the condition it serves and its estimated rows
+typedef struct query_plan {
+    QUERY_ACCESS access;
+    int term; // Condition served by the path, -1 for a full scan
+    int estimate;
+} QUERY_PLAN;
+
+// Matching student IDs of one name or programme lookup, valid while its column version is unchanged
+typedef struct query_cache_entry {
+    QUERY_FIELD field; // QUERY_NAME or QUERY_PROGRAMME
+    char keyword[MAX_PROGRAMME_LEN + 1]; // Lowercase keyword looked up
+    unsigned int version; // column_versions[field] when the IDs were collected
+    int* ids; // Matching IDs in list order
+    int count;
+    struct query_cache_entry* newer; // Neighbours in least recently used order
+    struct query_cache_entry* older;
+} QUERY_CACHE_ENTRY;
+
+// Bounded least recently used cache of name and programme lookups
+typedef struct query_cache {
+    QUERY_CACHE_ENTRY* newest;
+    QUERY_CACHE_ENTRY* oldest;
+    int count;
+    size_t bytes; // Entries and their ID arrays
+    long hits;
+    long misses;
+    long invalidations; // Entries found stale because their column changed
+    long evictions; // Entries dropped to stay within QUERY_CACHE_ENTRIES and QUERY_CACHE_MAX_BYTES
+} QUERY_CACHE;
+
+// Set of scan kernels for one instruction set, each fills a bitmap with bit i set if row i matches
+// Bitmaps hold one bit per row in 64-bit words, rows are counted from the first bit of the first word
+typedef struct scan_kernels {
+    const char* name;
+    void (*id_digits_contain)(const char* id_digits, int count, const char* digits, uint64_t* bitmap);
+} SCAN_KERNELS;
+
+// Posting list of one trigram in the name index
+typedef struct name_gram {
+    unsigned int key; // Three lowercased name characters packed into 24 bits, 0 marks an empty entry
+    int* slots; // Record table slots of nodes whose name contained the trigram when indexed
+    int count;
+    int capacity;
+} NAME_GRAM;
+
+// Inverted trigram index over lowercased names, narrows name queries to candidates that are then verified
+// Deleted or renamed nodes leave stale postings behind, verification skips them until the index is rebuilt
+typedef struct name_index {
+    NAME_GRAM* grams; // Open-addressing (linear probing) table of posting lists
+    int capacity; // Always a power of two
+    int count; // Distinct trigrams
+    long postings; // Postings in all lists
+    long stale; // Postings left behind by deleted or renamed nodes
+    int is_built; // 0 until built at open, queries scan the linked list while unbuilt
+} NAME_INDEX;
+
 // Global variables
 STUDENT_NODE* head = NULL; // Initialize head pointer for linked list
 STUDENT_NODE* tail = NULL; // Initialize tail pointer for linked list
 int node_count = 0; // Number of nodes in linked list
 int is_file_open = 0; // Track whether database has been loaded to linked list
 int is_changes_made = 0; // Track whether changes has been made to linked list
+int is_snapshot_unsaved = 0; // Records opened from binary snapshot are not in database file yet, CLOSE must ask before saving them
+ID_INDEX id_index; // Hash index on student ID, lives as long as the linked list (locks set up by id_index_locks_init)
+RECORD_TABLE record_table = { { { NULL, NULL } }, 0, 0, NULL, 0, 0, 0 }; // Storage for all linked list nodes
+int worker_thread_count = 1; // Threads used to parse database file, set with "--threads N"
+WAL wal = { NULL, NULL, 0, 0, 0 }; // Write-ahead log of the open database
+STRING_DICT programme_dict = { NULL, 0, 0, NULL, 0 }; // Distinct programme names of the open database
+NAME_INDEX name_index = { NULL, 0, 0, 0, 0, 0 }; // Trigram index on student names of the open database
+NODE_BUCKET grade_buckets[GRADE_COUNT] = { { NULL, 0, 0 } }; // Nodes of the open database grouped by grade
+NODE_BUCKET marks_buckets[MARKS_BUCKETS] = { { NULL, 0, 0 } }; // Marks index, nodes grouped by marks rounded to tenths
+ID_SUFFIX_INDEX id_suffix_index = { NULL, 0, NULL, 0, NULL, 0, 0, 0, 0 }; // Substring index on student IDs of the open database
+QUERY_CACHE query_cache = { NULL, NULL, 0, 0, 0, 0, 0, 0 }; // Recent name and programme lookups of the open database
+unsigned int column_versions[QUERY_FIELD_COUNT] = { 0 }; // Bumped whenever records of a column may match differently
+STORE store = { PTHREAD_MUTEX_INITIALIZER, (uint64_t)1 << 32, 2, { 0 }, NULL, NULL, NULL, NULL }; // Version 1 is the empty store
+SORTED_ORDER sorted_orders[SORT_COLUMN_COUNT] = { { NULL, 0, 0, 0, 0 } }; // Sorted orders by column of the open database
+STATS_TABLE stats_table = { NULL, 0, 1 }; // Per-programme aggregates of the open database (empty list, so built)
+SCAN_KERNELS scan_kernels; // Fastest scan kernels supported by this CPU, set by scan_kernels_init()
+const char* const GRADE_NAMES[GRADE_COUNT] = { "A+", "A", "A-", "B+", "B", "B-", "C+", "C", "D+", "D", "F" };
+const char* const SORT_COLUMN_NAMES[SORT_COLUMN_COUNT] = { "Student ID", "Name", "Programme", "Marks" };
+const char* const QUERY_FIELD_NAMES[QUERY_FIELD_COUNT] = { "ID", "NAME", "PROGRAMME", "MARKS", "GRADE" };
+const char* const QUERY_OP_NAMES[QUERY_OP_COUNT] = { "!=", "<=", ">=", "=", "<", ">", "CONTAINS" }; // Two-character operators first, parsing takes the first that matches
+const char* const QUERY_ACCESS_NAMES[ACCESS_COUNT] = { "Full scan", "ID index", "ID suffix index", "Name trigram index", "Grade buckets", "Marks index" };
 
 // Main function prototypes
 void open_db();
 void show_all_records();
+void show_record_pages();
+void show_sorted_records();
+void show_stats();
 void insert_record();
 void query_record();
 void update_record();
 void delete_record();
-void save_db();
+void save_db(FILE* messages, FILE* report);
 void close_db();
+void import_records();
 
 // Get input function prototypes
 int get_id(int* id);
@@ -44,99 +451,440 @@ int get_name(char* name);
 int get_programme(char* programme);
 int get_marks(float* marks);
 int get_choice(); // Get 'y' or 'n' input 
+const char* check_id(const char* id_input, int* id);
+const char* check_name(char* name_input, char* name);
+const char* check_programme(char* programme_input, char* programme);
+const char* check_marks(const char* marks_input, float* marks);
 
 // Utiltiy function prototypes
-char* calculate_grade(float marks);
+const char* calculate_grade(float marks);
+GRADE calculate_grade_code(float marks);
+const char* grade_name(int grade);
 void reset_list();
-void skip_header_lines(FILE* file_ptr);
+const char* skip_header_lines(const char* data, const char* end);
+char* map_file(const char* file_name, size_t* size);
+void unmap_file(char* data, size_t size);
+int parse_record_line(const char* line, const char* end, STUDENT_RECORD* record);
+int fill_node(STUDENT_NODE* node, const STUDENT_RECORD* record);
+int append_node(STUDENT_NODE* node);
+const char* programme_name(int code);
+void load_records(const char* data, const char* end);
+void load_records_parallel(const char* data, const char* end);
+void* load_worker(void* arg);
+char* format_int(char* out, int value);
+int marks_to_tenths(float marks);
+char* format_marks(char* out, float marks);
+char* format_record_line(char* out, const STUDENT_NODE* node);
+char* format_table_row(char* out, const STUDENT_NODE* node);
+STUDENT_NODE* write_table_rows(FILE* file, STUDENT_NODE* from, int count);
+int write_record_table(FILE* file);
+int write_sorted_table(FILE* file, SORT_COLUMN column, int is_descending);
+int sync_and_close(FILE* file_ptr);
+int replace_file(const char* temp_file_name, const char* file_name);
+int update_node(STUDENT_NODE* node, const char* name, const char* programme, float marks);
+void remove_node(STUDENT_NODE* node);
 void display_press_enter();
 void clean_fgets(char* input);
 void display_menu();
 void run_cmd(char* cmd);
 
+// String dictionary function prototypes
+int dict_intern(STRING_DICT* dict, const char* string);
+void dict_free(STRING_DICT* dict);
+
+// Binary snapshot function prototypes
+int save_snapshot(FILE* messages, FILE* report);
+void open_snapshot();
+
+// Write-ahead log function prototypes
+int wal_open();
+void wal_log(char type, const STUDENT_NODE* node);
+void wal_commit();
+int wal_replay();
+int wal_truncate();
+void wal_close();
+
+// Name trigram index function prototypes
+int name_index_build();
+int name_index_add(STUDENT_NODE* node);
+void name_index_forget(STUDENT_NODE* node);
+const int* name_index_candidates(const char* lowercase_query, int* count);
+void name_index_free();
+
+// Grade bucket and marks index function prototypes
+int node_bucket_add(NODE_BUCKET* bucket, STUDENT_NODE* node);
+STUDENT_NODE* node_bucket_remove(NODE_BUCKET* bucket, int pos);
+void node_buckets_free(NODE_BUCKET* buckets, int count);
+int marks_bucket(float marks);
+int bucket_indexes_add(STUDENT_NODE* node);
+void bucket_indexes_remove(STUDENT_NODE* node);
+int marks_index_collect(int min_tenths, int max_tenths, int limit, int is_descending, STUDENT_NODE** out);
+int compare_node_marks(const void* a, const void* b);
+int compare_node_marks_desc(const void* a, const void* b);
+
+// ID suffix index function prototypes
+int id_suffix_build();
+void id_suffix_add(STUDENT_NODE* node);
+void id_suffix_remove(STUDENT_NODE* node);
+int id_suffix_range(const char* digits, int* first_entry, int* end_entry);
+int id_suffix_find(const char* digits, STUDENT_NODE*** matches);
+void id_suffix_free();
+
+// Sorted order function prototypes
+int compare_sort_keys(SORT_COLUMN column, const STUDENT_NODE* a, const STUDENT_NODE* b);
+int compare_node_id(const void* a, const void* b);
+int compare_node_name(const void* a, const void* b);
+int compare_node_programme(const void* a, const void* b);
+void sort_nodes(STUDENT_NODE** nodes, int count, int (*compare)(const void* a, const void* b));
+int sort_nodes_parallel(STUDENT_NODE** nodes, int count, int (*compare)(const void* a, const void* b));
+void* sort_worker(void* arg);
+int sorted_order_build(SORT_COLUMN column);
+void sorted_orders_build();
+void sorted_order_flatten(const SORTED_ORDER* order, STUDENT_NODE** nodes);
+void sorted_orders_add(STUDENT_NODE* node);
+void sorted_orders_remove(STUDENT_NODE* node);
+void sorted_orders_free();
+
+// Statistics function prototypes
+void programme_stats_add(STUDENT_NODE* node);
+void programme_stats_remove(STUDENT_NODE* node);
+int stats_table_build();
+void stats_table_free();
+int histogram_rank(const int* marks_counts, int rank);
+int write_stats(FILE* file);
+
+// Record store concurrency function prototypes
+void store_write_begin();
+void store_write_end();
+void store_collect_garbage();
+void store_free_versions();
+int store_read_begin(STORE_READER* reader);
+void store_read_end(STORE_READER* reader);
+int store_read_node(const STORE_READER* reader, const STUDENT_NODE* node, STUDENT_NODE* copy);
+int store_snapshot_slots(const STORE_READER* reader, int* slots);
+void table_retire_node(STUDENT_NODE* node);
+int run_stress_test(int reader_count, int writer_count, int seconds);
+
+// Parallel scan function prototypes
+typedef int (*SCAN_PREDICATE)(const STUDENT_NODE* node, const void* context);
+int scan_records(const STORE_READER* reader, SCAN_PREDICATE predicate, const void* context, STUDENT_NODE** matches);
+void* scan_worker(void* arg);
+int name_contains(const STUDENT_NODE* node, const void* lowercase_keyword);
+int programme_code_matched(const STUDENT_NODE* node, const void* is_code_matched);
+
+// WHERE query function prototypes
+const char* query_parse(const char* conditions, QUERY* query);
+int query_matches(const STUDENT_NODE* node, const void* query);
+void query_free(QUERY* query);
+int query_plan(QUERY* query, QUERY_PLAN* plans, int* plan_count);
+char* query_format(const QUERY* query, int term, char* out);
+const char* write_query_results(FILE* file, const char* conditions);
+const char* write_query_plan(FILE* file, const char* conditions);
+void query_where(int is_explain);
+
+// Query cache function prototypes
+void column_versions_bump(QUERY_FIELD field);
+int query_cache_find(QUERY_FIELD field, const char* keyword, STUDENT_NODE** matches);
+void query_cache_store(QUERY_FIELD field, const char* keyword, STUDENT_NODE** matches, int count);
+void query_cache_drop(QUERY_CACHE_ENTRY* entry);
+void query_cache_free();
+void write_cache_stats(FILE* file);
+
+// Server mode function prototypes
+int run_server(const char* socket_path);
+
+// Batch mode function prototypes
+int run_batch(FILE* in, FILE* out);
+const char* run_batch_line(char* line, FILE* out);
+
+// CSV import function prototypes
+STUDENT_RECORD* import_csv_read(const char* file_name, int* count, int* rejected, FILE* report);
+int import_csv_append(const STUDENT_RECORD* records, int count);
+
+// Scan kernel function prototypes
+void scan_kernels_init();
+int scan_kernel_levels(SCAN_KERNELS* levels);
+int bitmap_next(const uint64_t* bitmap, int words, int from);
+void run_scan_benchmark(int rows);
+
+// ID hash index function prototypes
+void id_index_locks_init();
+int id_index_init(int expected_count);
+STUDENT_NODE* id_index_find(int id);
+int id_index_insert(STUDENT_NODE* node);
+STUDENT_NODE* id_index_remove(int id);
+int id_index_count();
+void id_index_free();
+void run_id_index_benchmark(int max_threads);
+
+// Record table function prototypes
+STUDENT_NODE* table_alloc_node();
+STUDENT_NODE* table_node(int slot);
+const char* table_id_digits(int slot);
+void table_release_node(STUDENT_NODE* node);
+void table_sync_columns(STUDENT_NODE* node);
+int table_segment_size(int segment);
+void table_free();
+void write_memory_stats(FILE* file);
+int compare_node_seq(const void* a, const void* b);
+
 // Program starts here
-int main() {
+int main(int argc, char* argv[]) {
+    scan_kernels_init(); // Pick SIMD scan kernels supported by this CPU
+    id_index_locks_init();
+    for (int i = 1; i < argc; i++) { // Parse command line options
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            worker_thread_count = atoi(argv[++i]);
+            if (worker_thread_count < 1) worker_thread_count = 1;
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) { // Run commands from file ("-" for stdin) and exit
+            FILE* in = strcmp(argv[i + 1], "-") == 0 ? stdin : fopen(argv[i + 1], "r");
+            if (!in) {
+                fprintf(stderr, "\n[Error] Batch file \"%s\" not found!\n", argv[i + 1]);
+                return 1;
+            }
+            int failed = run_batch(in, stdout);
+            if (in != stdin) fclose(in);
+            return failed ? 1 : 0;
+        }
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) { // Serve database to clients on a Unix socket until stopped
+            return run_server(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--stress-mvcc") == 0) { // Check snapshot readers against concurrent writers and exit
+            int readers = i + 1 < argc ? atoi(argv[i + 1]) : 0;
+            int writers = i + 2 < argc ? atoi(argv[i + 2]) : 0;
+            int seconds = i + 3 < argc ? atoi(argv[i + 3]) : 0;
+            return run_stress_test(readers > 0 ? readers : 4, writers > 0 ? writers : 2, seconds > 0 ? seconds : 3);
+        }
+        else if (strcmp(argv[i], "--bench-id-index") == 0) { // Measure ID index throughput with 1 to N threads and exit
+            int threads = i + 1 < argc ? atoi(argv[i + 1]) : 0;
+            run_id_index_benchmark(threads > 0 ? threads : ID_BENCH_THREADS);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--bench-scan") == 0) { // Measure scan kernels and exit
+            int rows = i + 1 < argc ? atoi(argv[i + 1]) : 0;
+            run_scan_benchmark(rows > 0 ? rows : SCAN_BENCH_ROWS);
+            return 0;
+        }
+        else {
+            fprintf(stderr, "Usage: %s [--threads N] [--batch FILE] [--serve SOCKET] [--bench-scan [ROWS]] [--bench-id-index [THREADS]] [--stress-mvcc [READERS [WRITERS [SECONDS]]]]\n", argv[0]);
+            return 1;
+        }
+    }
     char cmd[16];
     while (1) {
         display_menu(); // Display different menu depending if db file is open or not
         fgets(cmd, sizeof(cmd), stdin);
         clean_fgets(cmd);
-        run_cmd(cmd);
+        run_cmd(cmd); // Takes the store write lock only around its changes, never while waiting on the user
+        wal_commit(); // Group commit every change made by the command with one fsync
     }
     return 0;
 }
 
 void open_db() {
-    FILE* file_ptr = fopen(FILE_NAME, "r");
-    if (!file_ptr) { // Handle file not found error
+    size_t file_size;
+    char* file_data = map_file(FILE_NAME, &file_size); // Map whole database file into memory
+    if (!file_data) { // Handle file not found error
         fprintf(stderr, "\n[Error] Database file \"%s\" not found! Ensure correct file path is provided!\n", FILE_NAME);
         return;
     }
-    skip_header_lines(file_ptr); // Skip header information for database
-    char header_line_buffer[256];
-    // Loop through opened file and start reading and loading student records into linked list
+    const char* file_end = file_data + file_size;
+    const char* body = skip_header_lines(file_data, file_end); // Skip header information for database
+    if (!id_index_init(0)) { // Start with an empty ID index, it grows as records are loaded
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+        unmap_file(file_data, file_size);
+        return;
+    }
+    // Split large files across worker threads, small files are not worth the thread start-up
+    if (worker_thread_count > 1 && file_end - body >= 2 * LOAD_MIN_CHUNK_BYTES) {
+        load_records_parallel(body, file_end);
+    }
+    else {
+        load_records(body, file_end);
+    }
+    unmap_file(file_data, file_size);
+    int replayed = wal_replay(); // Apply changes logged after the last save
+    name_index_build(); // On failure name queries scan the linked list instead
+    id_suffix_build(); // On failure ID queries scan the ID digits column instead
+    sorted_orders_build(); // On failure sorted listings build their order when first needed
+    if (!wal_open()) {
+        fprintf(stderr, "\n[Error] Unable to open write-ahead log \"%s\"! Changes are only kept in memory until SAVE!\n", WAL_FILE_NAME);
+    }
+    is_file_open = 1;
+    printf("\nCMS: Database file \"%s\" successfully opened! Found %d records!\n", FILE_NAME, node_count);
+    if (replayed > 0) {
+        is_changes_made = 1; // Recovered changes are not in the database file yet
+        printf("CMS: Recovered %d unsaved changes from write-ahead log \"%s\"!\n", replayed, WAL_FILE_NAME);
+    }
+}
+
+void show_all_records() {
+    if (!head) {
+        printf("\nCMS: No records found! 'INSERT' to add records!\n");
+        return;
+    }
+    if (!write_record_table(stdout)) {
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+        return;
+    }
+    display_press_enter();
+}
+
+// Show count, marks summary and grade distribution of every programme
+void show_stats() {
+    if (!head) {
+        printf("\nCMS: No records found! 'INSERT' to add records!\n");
+        return;
+    }
+    if ((!stats_table.is_built && !stats_table_build()) || !write_stats(stdout)) {
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+        return;
+    }
+    display_press_enter();
+}
+
+// Show all records sorted by a column chosen by the user, in ascending or descending order
+void show_sorted_records() {
+    if (!head) {
+        printf("\nCMS: No records found! 'INSERT' to add records!\n");
+        return;
+    }
+    char option[3];
+    int column;
     while (1) {
-        STUDENT_NODE* new_student_node = malloc(sizeof(STUDENT_NODE)); // Memory allocation for new student node
-        if (!new_student_node) {
-            fprintf(stderr, "\n[Error] Memory allocation failure!\n");
-            fclose(file_ptr); // Close file before exiting
+        printf("================= SORT MENU ===================\n");
+        printf("[1] Student ID [2] Name [3] Programme [4] Marks\n");
+        printf("===============================================\n");
+        printf("CMS <SHOW SORTED>: Enter Sort Option [1-4] ('Q' to cancel)\n>> P14_8: ");
+        fgets(option, sizeof(option), stdin);
+        clean_fgets(option);
+        if (strcasecmp(option, "q") == 0) {
+            printf("\nCMS <SHOW SORTED>: Sorted listing cancelled!\n");
             return;
         }
-        // Scan file lines, seperating fields based on commas
-        int read_result = fscanf(file_ptr, "%7d,%30[^,],%50[^,],%f,%s",
-            &new_student_node->id,
-            new_student_node->name,
-            new_student_node->programme,
-            &new_student_node->marks,
-            &new_student_node->grade);
-
-        if (read_result == EOF) {
-            free(new_student_node); // Free unused memory allocation
-            break; // Exit loop on end of file
-        }
-        else if (read_result != 5) { // Ensure proper fields
-            fprintf(stderr, "\n[Error] Malformed line in \"%s\" database!\n", DB_NAME);
-            free(new_student_node); // Free unused memory allocation
-            // Skip the rest of the line to move the file pointer forward
-            fgets(header_line_buffer, sizeof(header_line_buffer), file_ptr);
-            continue;
+        if (strlen(option) == 1 && option[0] >= '1' && option[0] <= '0' + SORT_COLUMN_COUNT) {
+            column = option[0] - '1';
+            break;
         }
-
-        // Insert new student node to back of linked list
-        new_student_node->next = NULL; // Initialize next pointer to NULL
-        if (head == NULL) { // Check if linked list is empty
-            head = new_student_node; // Set new node as head
+        fprintf(stderr, "\n[Error] Invalid input! Please enter option [1-4] only!\n");
+    }
+    int is_descending;
+    while (1) {
+        printf("CMS <SHOW SORTED>: Sort in [A]scending or [D]escending order? ('Q' to cancel)\n>> P14_8: ");
+        fgets(option, sizeof(option), stdin);
+        clean_fgets(option);
+        if (strcasecmp(option, "q") == 0) {
+            printf("\nCMS <SHOW SORTED>: Sorted listing cancelled!\n");
+            return;
         }
-        else {
-            tail->next = new_student_node; // Set new node to end of linked list
+        if (strcasecmp(option, "a") == 0 || strcasecmp(option, "d") == 0) {
+            is_descending = strcasecmp(option, "d") == 0;
+            break;
         }
-        tail = new_student_node; // Update tail pointer
-        node_count++;
+        fprintf(stderr, "\n[Error] Invalid input! Please enter 'A' or 'D' only!\n");
     }
-    fclose(file_ptr);
-    is_file_open = 1;
-    printf("\nCMS: Database file \"%s\" successfully opened! Found %d records!\n", FILE_NAME, node_count);
+    if (!write_sorted_table(stdout, column, is_descending)) {
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+        return;
+    }
+    display_press_enter();
 }
 
-void show_all_records() {
+// Prompt for WHERE query conditions, then list matching records or, for EXPLAIN, the plan used to find them
+void query_where(int is_explain) {
     if (!head) {
         printf("\nCMS: No records found! 'INSERT' to add records!\n");
         return;
     }
-
-    STUDENT_NODE* current = head;
-    printf("\n%-7s  %-30s  %-50s  %-10s %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
-    printf("===============================================================================================================\n");
-    while (current) {
-        printf("%-7d  %-30s  %-50s  %-10.1f %-10s\n",
-            current->id, current->name, current->programme, current->marks, current->grade);
-        current = current->next;
+    const char* label = is_explain ? "EXPLAIN" : "QUERY WHERE";
+    char conditions[QUERY_INPUT_LEN];
+    while (1) {
+        printf("CMS <%s>: Enter conditions, e.g. programme contains \"computer\" AND marks >= 70 ('Q' to cancel)\n>> P14_8: ", label);
+        fgets(conditions, sizeof(conditions), stdin);
+        clean_fgets(conditions);
+        if (strcasecmp(conditions, "q") == 0) {
+            printf("\nCMS <%s>: Query cancelled!\n", label);
+            return;
+        }
+        const char* error = is_explain ? write_query_plan(stdout, conditions) : write_query_results(stdout, conditions);
+        if (!error) break;
+        fprintf(stderr, "\n[Error] %s Please try again.\n", error);
     }
-    printf("===============================================================================================================\n");
-    printf("CMS <SHOW ALL>: Found %d records in \"%s\" database!\n", node_count, DB_NAME);
     display_press_enter();
 }
 
+// Show records one page at a time, user moves to next/previous page, jumps to a page or changes page size
+void show_record_pages() {
+    if (!head) {
+        printf("\nCMS: No records found! 'INSERT' to add records!\n");
+        return;
+    }
+    // Start node of every record position, so any page is reached without walking the list
+    STUDENT_NODE** nodes = malloc(node_count * sizeof(STUDENT_NODE*));
+    if (!nodes) {
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+        return;
+    }
+    int count = 0;
+    for (STUDENT_NODE* current = head; current; current = current->next) {
+        nodes[count++] = current;
+    }
+
+    int page_size = PAGE_SIZE_DEFAULT;
+    int page = 0;
+    char option[16];
+    while (1) {
+        int page_count = (count + page_size - 1) / page_size;
+        if (page >= page_count) page = page_count - 1;
+        int first = page * page_size;
+        int rows = count - first < page_size ? count - first : page_size;
+        printf("\n%-7s  %-30s  %-50s  %-10s %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+        printf("===============================================================================================================\n");
+        if (write_table_rows(stdout, nodes[first], rows) == nodes[first]) {
+            fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+            break;
+        }
+        printf("===============================================================================================================\n");
+        printf("CMS <SHOW PAGES>: Page %d of %d, records %d to %d of %d in \"%s\" database!\n",
+            page + 1, page_count, first + 1, first + rows, count, DB_NAME);
+        printf("CMS <SHOW PAGES>: [Enter]/'N' next, 'P' previous, page number to jump, 'S <size>' page size, 'Q' to quit\n>> P14_8: ");
+        fgets(option, sizeof(option), stdin);
+        clean_fgets(option);
+
+        if (strcasecmp(option, "q") == 0) break;
+        if (option[0] == '\0' || strcasecmp(option, "n") == 0) {
+            if (page + 1 < page_count) page++;
+            else printf("\nCMS <SHOW PAGES>: Already on the last page!\n");
+        }
+        else if (strcasecmp(option, "p") == 0) {
+            if (page > 0) page--;
+            else printf("\nCMS <SHOW PAGES>: Already on the first page!\n");
+        }
+        else if ((option[0] == 's' || option[0] == 'S') && isspace((unsigned char)option[1])) {
+            int size = atoi(option + 2);
+            if (size < 1 || size > PAGE_SIZE_MAX) {
+                fprintf(stderr, "\n[Error] Page size must be between 1 and %d! Please try again!\n", PAGE_SIZE_MAX);
+                continue;
+            }
+            page = first / size; // Keep the first record of the current page in view
+            page_size = size;
+        }
+        else if (strspn(option, "0123456789") == strlen(option)) {
+            int number = atoi(option);
+            if (number < 1 || number > page_count) {
+                fprintf(stderr, "\n[Error] Page number must be between 1 and %d! Please try again!\n", page_count);
+                continue;
+            }
+            page = number - 1;
+        }
+        else {
+            fprintf(stderr, "\n[Error] Invalid option! Please try again!\n");
+        }
+    }
+    free(nodes);
+}
+
 void insert_record() {
     // Display quick insert guide
     printf("\n==================== INSERT MENU =====================\n");
@@ -157,18 +905,12 @@ void insert_record() {
         printf("CMS <INSERT 1/4>: Enter a 7-Digit Student ID ('Q' to cancel)\n>> P14_8: ");
         int id_status = get_id(&id); // Prompts user for student ID and pass it through validation, and returns status code
         if (id_status == 1) { // User enters input
-            // After passing ID validation, check for duplicate student ID in linked list
-            int duplicate_found = 0;
-            STUDENT_NODE* current = head;
-            while (current) {
-                if (current->id == id) {
-                    printf("\nCMS <INSERT>: Record with student ID=\"%d\" already exists! Please try again!\n", id);
-                    duplicate_found = 1;
-                    break;
-                }
-                current = current->next; // Move to next node
+            // After passing ID validation, check for duplicate student ID through the ID index
+            if (id_index_find(id)) {
+                printf("\nCMS <INSERT>: Record with student ID=\"%d\" already exists! Please try again!\n", id);
+                continue;
             }
-            if (!duplicate_found) break; // Valid, non-duplicate student ID found
+            break; // Valid, non-duplicate student ID found
         }
         else if (id_status == 0) continue; // User enters invalid input, continue prompting
         else { // User cancels
@@ -231,28 +973,24 @@ void insert_record() {
     }
 
 
-    STUDENT_NODE* new_student_node = malloc(sizeof(STUDENT_NODE)); // Memory allocation for new student node
+    store_write_begin(); // Insert is one transaction of the record store
+    STUDENT_NODE* new_student_node = table_alloc_node(); // Take next slot in record table for new student node
     if (!new_student_node) {
+        store_write_end();
         fprintf(stderr, "\n[Error] Memory allocation failure!\n");
         return;
     }
     // Fill new student node
     new_student_node->id = id;
-    strncpy(new_student_node->name, name, MAX_NAME_LEN);
-    strncpy(new_student_node->programme, programme, MAX_PROGRAMME_LEN);
-    new_student_node->marks = marks;
-    strcpy(new_student_node->grade, calculate_grade(marks));
-
-    // Add new student to the end of linked list using tail pointer
-    new_student_node->next = NULL;
-    if (head == NULL) { // Linked list is empty
-        head = new_student_node;
-    }
-    else { // Linked list has elements
-        tail->next = new_student_node; // Point current tail to new student node
+    // Add new student to the end of linked list and index it
+    if (!update_node(new_student_node, name, programme, marks) || !append_node(new_student_node)) {
+        table_release_node(new_student_node);
+        store_write_end();
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+        return;
     }
-    tail = new_student_node;
-    node_count++;
+    wal_log('I', new_student_node);
+    store_write_end();
     is_changes_made = 1;
     printf("\nCMS <INSERT>: Student record inserted successfully!\n");
 }
@@ -269,8 +1007,9 @@ void query_record() {
         // Display the query menu
         printf("================= QUERY MENU ==================\n");
         printf("[1] Student ID [2] Name [3] Programme [4] Grade\n");
+        printf("[5] Marks Range [6] Top Marks [7] Bottom Marks\n");
         printf("===============================================\n");
-        printf("CMS <QUERY>: Enter Query Option [1-4] ('Q' to cancel)\n>> P14_8: ");
+        printf("CMS <QUERY>: Enter Query Option [1-7] ('Q' to cancel)\n>> P14_8: ");
         fgets(option, sizeof(option), stdin);
         clean_fgets(option); // Clean user input (remove trailing newline)
 
@@ -308,23 +1047,47 @@ void query_record() {
                     continue; // Prompt again
                 }
 
-                // Search for matching Student IDs in the linked list
-                STUDENT_NODE* current = head;
-                int record_found = 0; // Flag to check if any records are found
-                while (current) {
-                    char id_str[20];
-                    snprintf(id_str, sizeof(id_str), "%d", current->id); // Convert numeric ID to string
-
-                    if (strstr(id_str, id_input)) { // Check if input matches part of the ID
-                        if (!record_found) { // Display header if it's the first matching record
-                            printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
-                            printf("===============================================================================================================\n");
-                            record_found = 1;
+                // Look up matching Student IDs in the ID suffix index (already in list order)
+                STUDENT_NODE** matches = NULL;
+                int match_count = id_suffix_find(id_input, &matches);
+                if (match_count < 0) { // Index unavailable, sweep the ID digits column of the record table
+                    matches = malloc(node_count * sizeof(STUDENT_NODE*));
+                    int bitmap_words = (table_segment_size(record_table.segment_count - 1) + 63) / 64; // Enough for largest segment
+                    uint64_t* bitmap = malloc(bitmap_words * sizeof(uint64_t));
+                    if (!matches || !bitmap) {
+                        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                        free(matches);
+                        free(bitmap);
+                        break;
+                    }
+                    match_count = 0;
+                    int remaining = record_table.used; // Slots left to sweep
+                    for (int segment = 0; segment < record_table.segment_count && remaining > 0; segment++) {
+                        RECORD_SEGMENT* current_segment = &record_table.segments[segment];
+                        int size = table_segment_size(segment) < remaining ? table_segment_size(segment) : remaining;
+                        // Empty slots have no digits, so only live records can match
+                        scan_kernels.id_digits_contain(current_segment->id_digits, size, id_input, bitmap);
+                        for (int i = bitmap_next(bitmap, (size + 63) / 64, 0); i >= 0; i = bitmap_next(bitmap, (size + 63) / 64, i + 1)) {
+                            matches[match_count++] = &current_segment->nodes[i];
                         }
-                        printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current->id, current->name, current->programme, current->marks, current->grade);
+                        remaining -= size;
+                    }
+                    free(bitmap);
+                    // Recycled slots break slot order, so restore list order before display
+                    qsort(matches, match_count, sizeof(STUDENT_NODE*), compare_node_seq);
+                }
+
+                int record_found = 0; // Flag to check if any records are found
+                for (int i = 0; i < match_count; i++) {
+                    if (!record_found) { // Display header if it's the first matching record
+                        printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+                        printf("===============================================================================================================\n");
+                        record_found = 1;
                     }
-                    current = current->next; // Move to the next node
+                    STUDENT_NODE* current = matches[i];
+                    printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current->id, current->name, programme_name(current->programme_code), current->marks, grade_name(current->grade));
                 }
+                free(matches);
                 if (!record_found) { // If no records are found
                     printf("\nCMS <QUERY>: No records found with Student ID containing \"%s\". Please try again.\n", id_input);
                 }
@@ -377,26 +1140,72 @@ void query_record() {
                 }
                 lowercase_name[strlen(name)] = '\0';
 
-                // Search for matching names in the linked list
-                STUDENT_NODE* current = head;
-                int record_found = 0;
-                while (current) {
-                    char lowercase_student_name[100];
-                    for (int i = 0; current->name[i]; i++) {
-                        lowercase_student_name[i] = tolower(current->name[i]);
+                // Records are matched and shown as of one snapshot of the record store
+                STORE_READER reader;
+                if (!store_read_begin(&reader)) {
+                    fprintf(stderr, "\n[Error] Too many snapshot readers!\n");
+                    break;
+                }
+                STUDENT_NODE** matches = malloc((node_count + 1) * sizeof(STUDENT_NODE*));
+                if (!matches) {
+                    fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                    store_read_end(&reader);
+                    break;
+                }
+                // Repeated lookups are answered from the query cache until names change or records come and go
+                int match_count = query_cache_find(QUERY_NAME, lowercase_name, matches);
+                if (match_count < 0) {
+                    // Mostly stale posting lists, drop dead postings before searching (on failure queries scan instead)
+                    if (name_index.is_built && name_index.stale > name_index.postings / 2) {
+                        name_index_build();
                     }
-                    lowercase_student_name[strlen(current->name)] = '\0';
-
-                    if (strstr(lowercase_student_name, lowercase_name)) { // Check if input matches part of the name
-                        if (!record_found) { // Display header if it's the first matching record
-                            printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
-                            printf("===============================================================================================================\n");
-                            record_found = 1;
+                    int is_indexed = name_index.is_built && strlen(lowercase_name) >= NAME_GRAM_LEN;
+                    int candidate_count = 0;
+                    const int* candidates = NULL;
+                    if (is_indexed) { // Only nodes holding the rarest trigram of the query can match
+                        candidates = name_index_candidates(lowercase_name, &candidate_count);
+                    }
+                    if (candidate_count > node_count) { // Renames repeat postings, so candidates can outnumber records
+                        STUDENT_NODE** grown = realloc(matches, (candidate_count + 1) * sizeof(STUDENT_NODE*));
+                        if (!grown) {
+                            fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                            store_read_end(&reader);
+                            free(matches);
+                            break;
+                        }
+                        matches = grown;
+                    }
+                    match_count = 0;
+                    if (!is_indexed) match_count = scan_records(&reader, name_contains, lowercase_name, matches); // Check every record
+                    for (int i = 0; is_indexed && i < candidate_count; i++) {
+                        STUDENT_NODE* current = table_node(candidates[i]);
+                        STUDENT_NODE copy; // Stale postings of deleted nodes are not in the snapshot
+                        if (store_read_node(&reader, current, &copy) && name_contains(&copy, lowercase_name)) matches[match_count++] = current;
+                    }
+                    if (is_indexed) { // Postings are in slot order and may repeat after renames, restore list order
+                        qsort(matches, match_count, sizeof(STUDENT_NODE*), compare_node_seq);
+                        int unique_count = 0;
+                        for (int i = 0; i < match_count; i++) {
+                            if (unique_count == 0 || matches[unique_count - 1] != matches[i]) matches[unique_count++] = matches[i];
                         }
-                        printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current->id, current->name, current->programme, current->marks, current->grade);
+                        match_count = unique_count;
+                    }
+                    query_cache_store(QUERY_NAME, lowercase_name, matches, match_count);
+                }
+
+                int record_found = 0;
+                for (int i = 0; i < match_count; i++) {
+                    if (!record_found) { // Display header if it's the first matching record
+                        printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+                        printf("===============================================================================================================\n");
+                        record_found = 1;
                     }
-                    current = current->next; // Move to the next node
+                    STUDENT_NODE current;
+                    store_read_node(&reader, matches[i], &current); // Field values the query was checked on
+                    printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current.id, current.name, programme_name(current.programme_code), current.marks, grade_name(current.grade));
                 }
+                store_read_end(&reader); // Before waiting on the user, so writers can release what the snapshot held
+                free(matches);
                 if (!record_found) { // If no records are found
                     printf("\nCMS <QUERY>: No records found with name containing \"%s\". Please try again.\n", name);
                 }
@@ -449,26 +1258,57 @@ void query_record() {
                 }
                 lowercase_programme[strlen(programme)] = '\0';
 
-                // Search for matching programmes in the linked list
-                STUDENT_NODE* current = head;
-                int record_found = 0;
-                while (current) {
-                    char lowercase_student_programme[100];
-                    for (int i = 0; current->programme[i]; i++) {
-                        lowercase_student_programme[i] = tolower(current->programme[i]);
+                // Records are matched and shown as of one snapshot of the record store
+                STORE_READER reader;
+                if (!store_read_begin(&reader)) {
+                    fprintf(stderr, "\n[Error] Too many snapshot readers!\n");
+                    break;
+                }
+                STUDENT_NODE** matches = malloc((node_count + 1) * sizeof(STUDENT_NODE*));
+                if (!matches) {
+                    fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                    store_read_end(&reader);
+                    break;
+                }
+                // Repeated lookups are answered from the query cache until programmes change or records come and go
+                int match_count = query_cache_find(QUERY_PROGRAMME, lowercase_programme, matches);
+                if (match_count < 0) {
+                    // Match keyword against each distinct programme name once, then compare codes per record
+                    char* is_code_matched = calloc(programme_dict.count + 1, 1);
+                    if (!is_code_matched) {
+                        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                        store_read_end(&reader);
+                        free(matches);
+                        break;
                     }
-                    lowercase_student_programme[strlen(current->programme)] = '\0';
-
-                    if (strstr(lowercase_student_programme, lowercase_programme)) { // Check if input matches part of the programme
-                        if (!record_found) { // Display header if it's the first matching record
-                            printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
-                            printf("===============================================================================================================\n");
-                            record_found = 1;
+                    for (int code = 0; code < programme_dict.count; code++) {
+                        char lowercase_dict_programme[MAX_PROGRAMME_LEN + 1];
+                        const char* dict_programme = programme_dict.strings[code];
+                        int len = 0;
+                        for (; dict_programme[len]; len++) {
+                            lowercase_dict_programme[len] = tolower(dict_programme[len]);
                         }
-                        printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current->id, current->name, current->programme, current->marks, current->grade);
+                        lowercase_dict_programme[len] = '\0';
+                        is_code_matched[code] = strstr(lowercase_dict_programme, lowercase_programme) != NULL;
                     }
-                    current = current->next; // Move to the next node
+                    // Search for records with matching programme codes
+                    match_count = scan_records(&reader, programme_code_matched, is_code_matched, matches);
+                    free(is_code_matched);
+                    query_cache_store(QUERY_PROGRAMME, lowercase_programme, matches, match_count);
                 }
+                int record_found = 0;
+                for (int i = 0; i < match_count; i++) {
+                    if (!record_found) { // Display header if it's the first matching record
+                        printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+                        printf("===============================================================================================================\n");
+                        record_found = 1;
+                    }
+                    STUDENT_NODE current;
+                    store_read_node(&reader, matches[i], &current); // Field values the query was checked on
+                    printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current.id, current.name, programme_name(current.programme_code), current.marks, grade_name(current.grade));
+                }
+                store_read_end(&reader); // Before waiting on the user, so writers can release what the snapshot held
+                free(matches);
                 if (!record_found) { // If no records are found
                     printf("\nCMS <QUERY>: No records found with programme containing \"%s\". Please try again.\n", programme);
                 }
@@ -493,53 +1333,56 @@ void query_record() {
                 }
 
                 // Validate input (must be a valid grade)
-                const char* valid_grades[] = { "A+", "A", "A-", "B+", "B", "B-", "C+", "C", "D+", "D", "F" };
-                int valid = 0;
+                int query_grade = -1; // Grade code of input
                 if (strlen(grade) == 0) {
                     printf("\n[Error] Query is empty! Please try again.\n");
                     continue; // Prompt again
                 }
-                for (int i = 0; i < 11; i++) {
-                    if (strcasecmp(grade, valid_grades[i]) == 0) {
-                        valid = 1;
+                for (int i = 0; i < GRADE_COUNT; i++) {
+                    if (strcasecmp(grade, GRADE_NAMES[i]) == 0) {
+                        query_grade = i;
                         break;
                     }
                 }
-                if (!valid) {
+                if (query_grade < 0) {
                     printf("\n[Error] Invalid input! Allowed grades are: A+, A, A-, B+, B, B-, C+, C, D+, D, F.\n");
                     continue; // Prompt again
                 }
 
-                // Search for matching grades in the linked list
-                STUDENT_NODE* current = head;
-                int record_found = 0;
-                while (current) {
-                    // If the query is a specific grade, match it exactly
-                    if (strcasecmp(current->grade, grade) == 0) {
-                        if (!record_found) { // Display header if it's the first matching record
-                            printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
-                            printf("===============================================================================================================\n");
-                            record_found = 1;
-                        }
-                        printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current->id, current->name, current->programme, current->marks, current->grade);
+                // A single letter grade matches every grade of its letter (e.g., 'A' matches A+, A and A-)
+                int is_family = GRADE_NAMES[query_grade][1] == '\0';
+                int match_count = 0;
+                for (int i = 0; i < GRADE_COUNT; i++) {
+                    if (i == query_grade || (is_family && GRADE_NAMES[i][0] == GRADE_NAMES[query_grade][0])) {
+                        match_count += grade_buckets[i].count;
                     }
-
-                    // If the query is a general grade, match any subgrade
-                    else if ((strcasecmp(grade, "A") == 0 && (strcasecmp(current->grade, "A+") == 0 || strcasecmp(current->grade, "A-") == 0 || strcasecmp(current->grade, "A") == 0)) ||
-                        (strcasecmp(grade, "B") == 0 && (strcasecmp(current->grade, "B+") == 0 || strcasecmp(current->grade, "B-") == 0 || strcasecmp(current->grade, "B") == 0)) ||
-                        (strcasecmp(grade, "C") == 0 && (strcasecmp(current->grade, "C+") == 0 || strcasecmp(current->grade, "C") == 0)) ||
-                        (strcasecmp(grade, "D") == 0 && (strcasecmp(current->grade, "D+") == 0 || strcasecmp(current->grade, "D") == 0)) ||
-                        (strcasecmp(grade, "F") == 0 && (strcasecmp(current->grade, "F") == 0))) {
-                        if (!record_found) { // Display header if it's the first matching record
-                            printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
-                            printf("===============================================================================================================\n");
-                            record_found = 1;
-                        }
-                        printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current->id, current->name, current->programme, current->marks, current->grade);
+                }
+                STUDENT_NODE** matches = malloc((match_count + 1) * sizeof(STUDENT_NODE*));
+                if (!matches) {
+                    fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                    break;
+                }
+                match_count = 0;
+                for (int i = 0; i < GRADE_COUNT; i++) { // Concatenate matching buckets
+                    if (i == query_grade || (is_family && GRADE_NAMES[i][0] == GRADE_NAMES[query_grade][0])) {
+                        memcpy(matches + match_count, grade_buckets[i].nodes, grade_buckets[i].count * sizeof(STUDENT_NODE*));
+                        match_count += grade_buckets[i].count;
                     }
+                }
+                // Buckets are unordered, so restore list order before display
+                qsort(matches, match_count, sizeof(STUDENT_NODE*), compare_node_seq);
 
-                    current = current->next; // Move to the next node
+                int record_found = 0;
+                for (int i = 0; i < match_count; i++) {
+                    if (!record_found) { // Display header if it's the first matching record
+                        printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+                        printf("===============================================================================================================\n");
+                        record_found = 1;
+                    }
+                    STUDENT_NODE* current = matches[i];
+                    printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current->id, current->name, programme_name(current->programme_code), current->marks, grade_name(current->grade));
                 }
+                free(matches);
                 if (!record_found) { // If no records are found
                     printf("\nCMS <QUERY>: No records found with grade \"%s\". Please try again.\n", grade);
                 }
@@ -551,33 +1394,136 @@ void query_record() {
             }
         }
 
-        // Exit the query menu
-        else if (strcasecmp(option, "q") == 0) {
-            printf("\nCMS <QUERY>: Returning to the main menu...\n");
-            break;
-        }
+        // Option 5: Query by Marks Range
+        else if (strcmp(option, "5") == 0) {
+            while (1) { // Loop to ensure valid input
+                float min_marks, max_marks;
+                int status;
+                printf("CMS <QUERY>: Enter minimum marks (0.0 - 100.0) ('Q' to cancel)\n>> P14_8: ");
+                while ((status = get_marks(&min_marks)) == 0) { // Get marks from user, validates and prints any needed error msg
+                    printf("CMS <QUERY>: Enter minimum marks (0.0 - 100.0) ('Q' to cancel)\n>> P14_8: ");
+                }
+                if (status == 1) {
+                    printf("CMS <QUERY>: Enter maximum marks (0.0 - 100.0) ('Q' to cancel)\n>> P14_8: ");
+                    while ((status = get_marks(&max_marks)) == 0) {
+                        printf("CMS <QUERY>: Enter maximum marks (0.0 - 100.0) ('Q' to cancel)\n>> P14_8: ");
+                    }
+                }
+                if (status == -1) { // Check if user wants to cancel
+                    printf("\nCMS <QUERY>: Query by marks range cancelled! Returning to query menu.\n");
+                    break;
+                }
+                if (min_marks > max_marks) {
+                    printf("\n[Error] Minimum marks cannot be greater than maximum marks! Please try again.\n");
+                    continue; // Prompt again
+                }
 
-        // Handle invalid inputs
-        else {
-            fprintf(stderr, "\n[Error] Invalid input! Please enter option [1-4] only!\n");
+                // Visit only the marks index buckets between the two marks
+                STUDENT_NODE** matches = malloc(node_count * sizeof(STUDENT_NODE*));
+                if (!matches) {
+                    fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                    break;
+                }
+                int match_count = marks_index_collect(marks_to_tenths(min_marks), marks_to_tenths(max_marks), node_count, 0, matches);
+                for (int i = 0; i < match_count; i++) {
+                    if (i == 0) { // Display header before the first matching record
+                        printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+                        printf("===============================================================================================================\n");
+                    }
+                    STUDENT_NODE* current = matches[i];
+                    printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current->id, current->name, programme_name(current->programme_code), current->marks, grade_name(current->grade));
+                }
+                free(matches);
+                if (match_count == 0) { // If no records are found
+                    printf("\nCMS <QUERY>: No records found with marks between %.1f and %.1f. Please try again.\n", min_marks, max_marks);
+                }
+                else {
+                    printf("===============================================================================================================\n");
+                    display_press_enter();
+                    break; // Exit the loop after successful query
+                }
+            }
         }
-    }
-}
 
-void update_record() {
-    if (!head) {
-        printf("\nCMS <UPDATE>: No records to update! The database \"%s\" is empty!\n", DB_NAME);
-        return;
-    }
-    int id;
-    char name[MAX_NAME_LEN + 1]; // +1 for null terminator
-    char programme[MAX_PROGRAMME_LEN + 1]; // +1 for null terminator
-    float marks;
+        // Option 6 and 7: Query highest or lowest marks
+        else if (strcmp(option, "6") == 0 || strcmp(option, "7") == 0) {
+            int is_top = strcmp(option, "6") == 0;
+            while (1) { // Loop to ensure valid input
+                char count_input[10]; // Buffer for user input
+                printf("CMS <QUERY>: Enter number of records to show (1 - %d) ('Q' to cancel)\n>> P14_8: ", node_count);
+                fgets(count_input, sizeof(count_input), stdin);
+                clean_fgets(count_input); // Clean user input
 
-    while (1) {
-        printf("CMS <UPDATE>: Enter 7-Digit Student ID to Update ('Q' to stop UPDATE)\n>> P14_8: ");
-        int id_status = get_id(&id); // Prompt user for student ID and pass it through validation
-        if (id_status == -1) { // User cancels
+                if (strcasecmp(count_input, "q") == 0) { // Check if user wants to cancel
+                    printf("\nCMS <QUERY>: Query by %s marks cancelled! Returning to query menu.\n", is_top ? "top" : "bottom");
+                    break;
+                }
+
+                // Validate input (only numeric values from 1 to number of records allowed)
+                if (strlen(count_input) == 0) {
+                    printf("\n[Error] Query is empty! Please try again.\n");
+                    continue; // Prompt again
+                }
+                int valid = strlen(count_input) <= 7;
+                for (int i = 0; count_input[i] != '\0'; i++) {
+                    if (!isdigit(count_input[i])) { // Check if input contains non-numeric characters
+                        valid = 0;
+                        break;
+                    }
+                }
+                int limit = valid ? atoi(count_input) : 0;
+                if (limit < 1 || limit > node_count) {
+                    printf("\n[Error] Invalid input! Enter a number from 1 to %d. Please try again.\n", node_count);
+                    continue; // Prompt again
+                }
+
+                // Walk marks index buckets from the highest (or lowest) marks until limit records are collected
+                STUDENT_NODE** matches = malloc(node_count * sizeof(STUDENT_NODE*));
+                if (!matches) {
+                    fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                    break;
+                }
+                int match_count = marks_index_collect(0, INT_MAX, limit, is_top, matches); // Include marks above 100.0 from edited files
+                printf("\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+                printf("===============================================================================================================\n");
+                for (int i = 0; i < match_count; i++) {
+                    STUDENT_NODE* current = matches[i];
+                    printf("%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current->id, current->name, programme_name(current->programme_code), current->marks, grade_name(current->grade));
+                }
+                free(matches);
+                printf("===============================================================================================================\n");
+                display_press_enter();
+                break; // Exit the loop after successful query
+            }
+        }
+
+        // Exit the query menu
+        else if (strcasecmp(option, "q") == 0) {
+            printf("\nCMS <QUERY>: Returning to the main menu...\n");
+            break;
+        }
+
+        // Handle invalid inputs
+        else {
+            fprintf(stderr, "\n[Error] Invalid input! Please enter option [1-7] only!\n");
+        }
+    }
+}
+
+void update_record() {
+    if (!head) {
+        printf("\nCMS <UPDATE>: No records to update! The database \"%s\" is empty!\n", DB_NAME);
+        return;
+    }
+    int id;
+    char name[MAX_NAME_LEN + 1]; // +1 for null terminator
+    char programme[MAX_PROGRAMME_LEN + 1]; // +1 for null terminator
+    float marks;
+
+    while (1) {
+        printf("CMS <UPDATE>: Enter 7-Digit Student ID to Update ('Q' to stop UPDATE)\n>> P14_8: ");
+        int id_status = get_id(&id); // Prompt user for student ID and pass it through validation
+        if (id_status == -1) { // User cancels
             printf("\nCMS <UPDATE>: Update operation cancelled!\n");
             return;
         }
@@ -587,201 +1533,222 @@ void update_record() {
 
         char option[3];
         int record_found = 0;
-        STUDENT_NODE* current = head;
-
-        while (current) {
-            if (current->id == id) { // Record found
-                record_found = 1;
-                while (1) {
-                    printf("========================== STUDENT FOUND ===========================\n");
-                    printf("%11s %d\n", "Student ID:", current->id);
-                    printf("%11s %s\n", "Name:", current->name);
-                    printf("%11s %s\n", "Programme:", current->programme);
-                    printf("%11s %.1f\n", "Marks:", current->marks);
-                    printf("%11s %s\n", "Grade:", current->grade);
-                    printf("====================================================================\n");
-                    printf("[1] Update Name [2] Update Programme [3] Update Marks [4] Update All\n");
-                    printf("====================================================================\n");
-                    printf("CMS <UPDATE>: Enter Update Option [1-4] ('Q' to cancel)\n>> P14_8: ");
-                    fgets(option, sizeof(option), stdin);
-                    clean_fgets(option);
-
-                    if (strcmp(option, "1") == 0) { // User chooses to update name
-                        while (1) {
-                            printf("CMS <UPDATE>: Enter New Student Name ('Q' to stop updating Name)\n>> P14_8: ");
-                            int name_status = get_name(name); // Prompt user for student name and pass it through validation
-                            if (name_status == -1) { // User cancels
-                                printf("\nCMS <UPDATE>: Update by name cancelled!\n");
-                                break;
-                            }
-                            if (name_status == 0) { // Invalid input, prompt again
-                                printf("\n[Error] Invalid name input. Please try again.\n");
-                                continue;
-                            }
-                            while(1){
-                                 printf("CMS <UPDATE>: Confirm name update from \"%s\" to \"%s\"? (Y/N)\n>> P14_8:  ", current->name, name);
-                                int confirm_status = get_choice();
-                                if (confirm_status == 1) { // User confirms
-                                    strncpy(current->name, name, MAX_NAME_LEN);
-                                    printf("\nCMS <UPDATE>: Name successfully updated!\n");
-                                    is_changes_made = 1;
-                                    break;
-                                }
-                                else if(confirm_status == 0){
-                                    printf("\nCMS <UPDATE>: Update by name cancelled!\n");
-                                    break;
-                                }
-                            }
+        STUDENT_NODE* current = id_index_find(id); // Look up record through the ID index
+
+        if (current) { // Record found
+            record_found = 1;
+            while (1) {
+                printf("========================== STUDENT FOUND ===========================\n");
+                printf("%11s %d\n", "Student ID:", current->id);
+                printf("%11s %s\n", "Name:", current->name);
+                printf("%11s %s\n", "Programme:", programme_name(current->programme_code));
+                printf("%11s %.1f\n", "Marks:", current->marks);
+                printf("%11s %s\n", "Grade:", grade_name(current->grade));
+                printf("====================================================================\n");
+                printf("[1] Update Name [2] Update Programme [3] Update Marks [4] Update All\n");
+                printf("====================================================================\n");
+                printf("CMS <UPDATE>: Enter Update Option [1-4] ('Q' to cancel)\n>> P14_8: ");
+                fgets(option, sizeof(option), stdin);
+                clean_fgets(option);
+
+                if (strcmp(option, "1") == 0) { // User chooses to update name
+                    while (1) {
+                        printf("CMS <UPDATE>: Enter New Student Name ('Q' to stop updating Name)\n>> P14_8: ");
+                        int name_status = get_name(name); // Prompt user for student name and pass it through validation
+                        if (name_status == -1) { // User cancels
+                            printf("\nCMS <UPDATE>: Update by name cancelled!\n");
                             break;
                         }
-                    }
-                    else if (strcmp(option, "2") == 0) { // User chooses to update programme
-                        while (1) {
-                            printf("CMS <UPDATE>: Enter New Programme ('Q' to stop updating Programme)\n>> P14_8: ");
-                            int programme_status = get_programme(programme); // Prompt user for programme name and pass it through validation
-                            if (programme_status == -1) { // User cancels
-                                printf("\nCMS <UPDATE>: Update by programme cancelled!\n");
-                                break;
-                            }
-                            if (programme_status == 0) { // Invalid input, prompt again
-                                printf("\n[Error] Invalid programme input. Please try again.\n");
-                                continue;
-                            }
-                            while(1){
-                                printf("CMS <UPDATE>: Confirm programme update from \"%s\" to \"%s\"? (Y/N)\n>> ", current->programme, programme);
-                                int confirm_status = get_choice();
-                                if (confirm_status == 1) { // User confirms
-                                    strncpy(current->programme, programme, MAX_PROGRAMME_LEN);
-                                    printf("\nCMS <UPDATE>: Programme successfully updated!\n");
-                                    is_changes_made = 1;
-                                    break;
-                                }
-                                else if (confirm_status == 0){
-                                    printf("\nCMS <UPDATE>: Update by programme cancelled!\n");
+                        if (name_status == 0) { // Invalid input, prompt again
+                            printf("\n[Error] Invalid name input. Please try again.\n");
+                            continue;
+                        }
+                        while(1){
+                             printf("CMS <UPDATE>: Confirm name update from \"%s\" to \"%s\"? (Y/N)\n>> P14_8:  ", current->name, name);
+                            int confirm_status = get_choice();
+                            if (confirm_status == 1) { // User confirms
+                                store_write_begin();
+                                int is_updated = update_node(current, name, programme_name(current->programme_code), current->marks);
+                                if (is_updated) wal_log('U', current);
+                                store_write_end();
+                                if (!is_updated) {
+                                    fprintf(stderr, "\n[Error] Memory allocation failure! Name not updated!\n");
                                     break;
                                 }
-                            }
-                            break;
-                        }
-                    }
-                    else if (strcmp(option, "3") == 0) { // User chooses to update marks
-                        while (1) {
-                            printf("CMS <UPDATE>: Enter New Marks ('Q' to stop updating Marks)\n>> P14_8: ");
-                            int marks_status = get_marks(&marks); // Prompt user for marks and pass it through validation
-                            if (marks_status == -1) { // User cancels
-                                printf("\nCMS <UPDATE>: Update by marks cancelled!\n");
+                                printf("\nCMS <UPDATE>: Name successfully updated!\n");
+                                is_changes_made = 1;
                                 break;
                             }
-                            if (marks_status == 0) { // Invalid input, prompt again
-                                continue;
-                            }
-                            while(1){
-                                printf("CMS <UPDATE>: Confirm updating marks from \"%.1f\" to \"%.1f\"? (Y/N)\n>> P14_8: ", current->marks, marks);
-                                int confirm_status = get_choice();
-                                if (confirm_status == 1) { // User confirms
-                                    current->marks = marks;
-                                    strcpy(current->grade, calculate_grade(marks));
-                                    printf("\nCMS <UPDATE>: Marks successfully updated!\n");
-                                    is_changes_made = 1;
-                                    break;
-                                }
-                                else if(confirm_status == 0){
-                                    printf("\nCMS <UPDATE>: Update by marks cancelled!\n");
-                                    break;
-                                }
+                            else if(confirm_status == 0){
+                                printf("\nCMS <UPDATE>: Update by name cancelled!\n");
+                                break;
                             }
-                            break;
                         }
+                        break;
                     }
-                    
-                    else if (strcmp(option, "4") == 0) { // User chooses to update marks
-                        int if_cancel = 0;
-                        // Update name
-                        while (1) {
-                            printf("CMS <UPDATE>: Enter New Name ('Q' to stop updating)\n>> P14_8: ");
-                            int name_status = get_name(name); // Prompt user for marks and pass it through validation
-                            if (name_status == -1) { // User cancels
-                                printf("\nCMS <UPDATE>: Update operation cancelled!\n");
-                                if_cancel = 1;
-                                break;
-                            }
-                            if (name_status == 0) { // Invalid input, prompt again
-                                continue;
-                            }
+                }
+                else if (strcmp(option, "2") == 0) { // User chooses to update programme
+                    while (1) {
+                        printf("CMS <UPDATE>: Enter New Programme ('Q' to stop updating Programme)\n>> P14_8: ");
+                        int programme_status = get_programme(programme); // Prompt user for programme name and pass it through validation
+                        if (programme_status == -1) { // User cancels
+                            printf("\nCMS <UPDATE>: Update by programme cancelled!\n");
                             break;
                         }
-                        if(if_cancel) continue;
-
-                        // Update programme
-                        while (1) {
-                            printf("CMS <UPDATE>: Enter New Programme ('Q' to stop updating)\n>> P14_8: ");
-                            int programme_status = get_programme(programme); // Prompt user for marks and pass it through validation
-                            if (programme_status == -1) { // User cancels
-                                printf("\nCMS <UPDATE>: Update operation cancelled!\n");
-                                if_cancel = 1;
-                                break;
-                            }
-                            if (programme_status == 0) { // Invalid input, prompt again
-                                continue;
-                            }
-                            break;
+                        if (programme_status == 0) { // Invalid input, prompt again
+                            printf("\n[Error] Invalid programme input. Please try again.\n");
+                            continue;
                         }
-                        if(if_cancel) continue;
-
-                        // Update marks
-                        while (1) {
-                            printf("CMS <UPDATE>: Enter New Marks ('Q' to stop updating)\n>> P14_8: ");
-                            int marks_status = get_marks(&marks); // Prompt user for marks and pass it through validation
-                            if (marks_status == -1) { // User cancels
-                                printf("\nCMS <UPDATE>: Update operation cancelled!\n");
-                                if_cancel = 1;
+                        while(1){
+                            printf("CMS <UPDATE>: Confirm programme update from \"%s\" to \"%s\"? (Y/N)\n>> ", programme_name(current->programme_code), programme);
+                            int confirm_status = get_choice();
+                            if (confirm_status == 1) { // User confirms
+                                store_write_begin();
+                                int is_updated = update_node(current, current->name, programme, current->marks);
+                                if (is_updated) wal_log('U', current);
+                                store_write_end();
+                                if (!is_updated) {
+                                    fprintf(stderr, "\n[Error] Memory allocation failure! Programme not updated!\n");
+                                    break;
+                                }
+                                printf("\nCMS <UPDATE>: Programme successfully updated!\n");
+                                is_changes_made = 1;
                                 break;
                             }
-                            if (marks_status == 0) { // Invalid input, prompt again
-                                continue;
+                            else if (confirm_status == 0){
+                                printf("\nCMS <UPDATE>: Update by programme cancelled!\n");
+                                break;
                             }
+                        }
+                        break;
+                    }
+                }
+                else if (strcmp(option, "3") == 0) { // User chooses to update marks
+                    while (1) {
+                        printf("CMS <UPDATE>: Enter New Marks ('Q' to stop updating Marks)\n>> P14_8: ");
+                        int marks_status = get_marks(&marks); // Prompt user for marks and pass it through validation
+                        if (marks_status == -1) { // User cancels
+                            printf("\nCMS <UPDATE>: Update by marks cancelled!\n");
                             break;
                         }
-                        if(if_cancel) continue;
-
+                        if (marks_status == 0) { // Invalid input, prompt again
+                            continue;
+                        }
                         while(1){
-                            printf("==================== CONFIRM UPDATE =====================\n");
-                            printf("%10s %s -> %s\n", "Name:", current->name, name);
-                            printf("%10s %s -> %s\n", "Programme:", current->programme, programme);
-                            printf("%10s %.1f -> %.1f\n", "Marks:", current->marks, marks);
-                            printf("==========================================================\n");
-                      
-                            printf("CMS <UPDATE>: Confirm update? (Y/N)\n>> P14_8: ");
+                            printf("CMS <UPDATE>: Confirm updating marks from \"%.1f\" to \"%.1f\"? (Y/N)\n>> P14_8: ", current->marks, marks);
                             int confirm_status = get_choice();
                             if (confirm_status == 1) { // User confirms
-                                strncpy(current->name, name, MAX_NAME_LEN);
-                                strncpy(current->programme, programme, MAX_PROGRAMME_LEN);
-                                current->marks = marks;
-                                strcpy(current->grade, calculate_grade(marks));
-                                printf("\nCMS <UPDATE>: Update successful!\n");
+                                store_write_begin();
+                                int is_updated = update_node(current, current->name, programme_name(current->programme_code), marks);
+                                if (is_updated) wal_log('U', current);
+                                store_write_end();
+                                if (!is_updated) {
+                                    fprintf(stderr, "\n[Error] Memory allocation failure! Marks not updated!\n");
+                                    break;
+                                }
+                                printf("\nCMS <UPDATE>: Marks successfully updated!\n");
                                 is_changes_made = 1;
-                                return;
+                                break;
                             }
                             else if(confirm_status == 0){
-                                printf("\nCMS <UPDATE>: Update cancelled!\n");
-                                if_cancel = 1;
+                                printf("\nCMS <UPDATE>: Update by marks cancelled!\n");
                                 break;
                             }
-
-                        } 
-                        if(if_cancel) continue;
+                        }
+                        break;
                     }
-                    else if (strcasecmp(option, "q") == 0) { // User cancels
-                        printf("\nCMS <UPDATE>: Update operation cancelled!\n");
-                        return;
+                }
+                
+                else if (strcmp(option, "4") == 0) { // User chooses to update marks
+                    int if_cancel = 0;
+                    // Update name
+                    while (1) {
+                        printf("CMS <UPDATE>: Enter New Name ('Q' to stop updating)\n>> P14_8: ");
+                        int name_status = get_name(name); // Prompt user for marks and pass it through validation
+                        if (name_status == -1) { // User cancels
+                            printf("\nCMS <UPDATE>: Update operation cancelled!\n");
+                            if_cancel = 1;
+                            break;
+                        }
+                        if (name_status == 0) { // Invalid input, prompt again
+                            continue;
+                        }
+                        break;
                     }
-                    else { // User enters invalid input
-                        printf("\n[Error] Invalid option. Please enter [1-4] or 'Q' to cancel.\n");
-                        continue;
+                    if(if_cancel) continue;
+
+                    // Update programme
+                    while (1) {
+                        printf("CMS <UPDATE>: Enter New Programme ('Q' to stop updating)\n>> P14_8: ");
+                        int programme_status = get_programme(programme); // Prompt user for marks and pass it through validation
+                        if (programme_status == -1) { // User cancels
+                            printf("\nCMS <UPDATE>: Update operation cancelled!\n");
+                            if_cancel = 1;
+                            break;
+                        }
+                        if (programme_status == 0) { // Invalid input, prompt again
+                            continue;
+                        }
+                        break;
+                    }
+                    if(if_cancel) continue;
+
+                    // Update marks
+                    while (1) {
+                        printf("CMS <UPDATE>: Enter New Marks ('Q' to stop updating)\n>> P14_8: ");
+                        int marks_status = get_marks(&marks); // Prompt user for marks and pass it through validation
+                        if (marks_status == -1) { // User cancels
+                            printf("\nCMS <UPDATE>: Update operation cancelled!\n");
+                            if_cancel = 1;
+                            break;
+                        }
+                        if (marks_status == 0) { // Invalid input, prompt again
+                            continue;
+                        }
+                        break;
                     }
+                    if(if_cancel) continue;
+
+                    while(1){
+                        printf("==================== CONFIRM UPDATE =====================\n");
+                        printf("%10s %s -> %s\n", "Name:", current->name, name);
+                        printf("%10s %s -> %s\n", "Programme:", programme_name(current->programme_code), programme);
+                        printf("%10s %.1f -> %.1f\n", "Marks:", current->marks, marks);
+                        printf("==========================================================\n");
+                  
+                        printf("CMS <UPDATE>: Confirm update? (Y/N)\n>> P14_8: ");
+                        int confirm_status = get_choice();
+                        if (confirm_status == 1) { // User confirms
+                            store_write_begin();
+                            int is_updated = update_node(current, name, programme, marks);
+                            if (is_updated) wal_log('U', current);
+                            store_write_end();
+                            if (!is_updated) {
+                                fprintf(stderr, "\n[Error] Memory allocation failure! Record not updated!\n");
+                                return;
+                            }
+                            printf("\nCMS <UPDATE>: Update successful!\n");
+                            is_changes_made = 1;
+                            return;
+                        }
+                        else if(confirm_status == 0){
+                            printf("\nCMS <UPDATE>: Update cancelled!\n");
+                            if_cancel = 1;
+                            break;
+                        }
+
+                    } 
+                    if(if_cancel) continue;
+                }
+                else if (strcasecmp(option, "q") == 0) { // User cancels
+                    printf("\nCMS <UPDATE>: Update operation cancelled!\n");
+                    return;
+                }
+                else { // User enters invalid input
+                    printf("\n[Error] Invalid option. Please enter [1-4] or 'Q' to cancel.\n");
+                    continue;
                 }
             }
-            current = current->next;
         }
         if (!record_found) {
             printf("CMS: Record with student ID=\"%d\" not found!\n", id);
@@ -807,90 +1774,162 @@ void delete_record() {
             continue;
         }
 
-        STUDENT_NODE* current = head; // Setup current pointer to start from head
-        STUDENT_NODE* prev = NULL;  // Setup prev pointer for deleting node in linked list
-        while (current) {
-            // If student id input matches student id in database file
-            if (current->id == id) {
-                // Confirmation for delete
-                while (1) {
-                    printf("================== STUDENT FOUND ===================\n");
-                    printf("%11s %d\n", "Student ID:", current->id);
-                    printf("%11s %s\n", "Name:", current->name);
-                    printf("%11s %s\n", "Programme:", current->programme);
-                    printf("%11s %.1f\n", "Marks:", current->marks);
-                    printf("%11s %s (Auto-Calculated)\n", "Grade:", current->grade);
-                    printf("====================================================\n");
-                    printf("CMS <DELETE>: Confirm Delete? (Y/N)\n>> P14_8: ");
-                    int choice_status = get_choice(); // Get 'Y' or 'N' from user, validates and prints any needed error msg
-                    if (choice_status == 1) break;// User say yes
-                    if (choice_status == 0) { // User say no
-                        printf("\nCMS <DELETE>: Delete operation cancelled!\n");
-                        return;
-                    }
-                }
-                if (prev == NULL) { // Indicates that head node is the matched node
-                    head = current->next; // Delete current node which is head
-                }
-                else {
-                    prev->next = current->next; // Delete current node
-                }
-
-                if (current->next == NULL) { // Delete tail need if the last node happens to be matched node
-                    tail = prev;
-                }
-
-                free(current); // Free allocated memory for deleted node
-                current = NULL;
-
-                node_count--;
-                is_changes_made = 1; // Change status of changes made
-
-                // Handle empty list case
-                if (!head) {
-                    tail = NULL; // Update tail if the list becomes empty
+        STUDENT_NODE* current = id_index_find(id); // Look up record through the ID index
+        // If student id input matches student id in database file
+        if (current) {
+            // Confirmation for delete
+            while (1) {
+                printf("================== STUDENT FOUND ===================\n");
+                printf("%11s %d\n", "Student ID:", current->id);
+                printf("%11s %s\n", "Name:", current->name);
+                printf("%11s %s\n", "Programme:", programme_name(current->programme_code));
+                printf("%11s %.1f\n", "Marks:", current->marks);
+                printf("%11s %s (Auto-Calculated)\n", "Grade:", grade_name(current->grade));
+                printf("====================================================\n");
+                printf("CMS <DELETE>: Confirm Delete? (Y/N)\n>> P14_8: ");
+                int choice_status = get_choice(); // Get 'Y' or 'N' from user, validates and prints any needed error msg
+                if (choice_status == 1) break;// User say yes
+                if (choice_status == 0) { // User say no
+                    printf("\nCMS <DELETE>: Delete operation cancelled!\n");
+                    return;
                 }
-                printf("\nCMS <DELETE>: Record with student ID=\"%d\" successfully deleted!\n", id);
-                return;
             }
-
-            // If student id input does not match id in database file, move forward to next node
-            prev = current;
-            current = current->next;
+            store_write_begin();
+            wal_log('D', current); // Log delete while node fields are still intact
+            remove_node(current); // Unlink node, drop it from the ID index and recycle its slot
+            store_write_end();
+            current = NULL;
+            is_changes_made = 1; // Change status of changes made
+            printf("\nCMS <DELETE>: Record with student ID=\"%d\" successfully deleted!\n", id);
+            return;
         }
         // If student id input not found in database file
         printf("\nCMS <DELETE>: Record with student ID=\"%d\" not found!\n", id);
     }
 }
 
-void save_db() {
-    FILE* file_ptr = fopen(FILE_NAME, "w");
-    if (!file_ptr) { // Handle file not found error
-        fprintf(stderr, "\n[Error] Database file \"%s\" not found! Ensure correct file path is provided!\n", FILE_NAME);
-        return;
+// Add student records from a CSV file after validating every line and confirming with the user
+void import_records() {
+    printf("\n==================== IMPORT MENU =====================\n");
+    printf("CSV lines must be \"[ID],[Name],[Programme],[Marks]\":\n");
+    printf("- Each field follows the same rules as INSERT\n");
+    printf("- Grades are auto-calculated from marks\n");
+    printf("- Blank lines and a \"[ID],...\" header line are skipped\n");
+    printf("======================================================\n");
+
+    char file_name[IMPORT_FILE_NAME_LEN + 2]; // +1 for null terminator, +1 for buffer
+    int count, rejected;
+    STUDENT_RECORD* records;
+    while (1) {
+        printf("CMS <IMPORT>: Enter CSV file name ('Q' to cancel)\n>> P14_8: ");
+        fgets(file_name, sizeof(file_name), stdin);
+        clean_fgets(file_name);
+        if (strcasecmp(file_name, "Q") == 0) {
+            printf("\nCMS <IMPORT>: Import operation cancelled!\n");
+            return;
+        }
+        if (file_name[0] == '\0') {
+            fprintf(stderr, "\n[Error] CSV file name cannot be empty! Please try again!\n");
+            continue;
+        }
+        records = import_csv_read(file_name, &count, &rejected, stderr); // Rejected lines are reported as they are found
+        if (records) break;
+        fprintf(stderr, "\n[Error] CSV file \"%s\" could not be read! Please try again!\n", file_name);
     }
-    // Write new database file header
-    fprintf(file_ptr, "==============================\n");
-    fprintf(file_ptr, "File Name: %s\n", FILE_NAME);
-    fprintf(file_ptr, "Database Name: %s\n", DB_NAME);
-    fprintf(file_ptr, "==============================\n");
-    fprintf(file_ptr, "[ID],[Name],[Programme],[Marks],[Grade]\n");
 
-    if (head) {
+    printf("\nCMS <IMPORT>: %d valid records found, %d lines rejected!\n", count, rejected);
+    if (count == 0) {
+        printf("CMS <IMPORT>: Nothing to import!\n");
+        free(records);
+        return;
+    }
+    while (1) {
+        printf("CMS <IMPORT>: Confirm Import of %d records? (Y/N)\n>> P14_8: ", count);
+        int choice_status = get_choice();
+        if (choice_status == 1) break;
+        if (choice_status == 0) {
+            printf("\nCMS <IMPORT>: Import operation cancelled!\n");
+            free(records);
+            return;
+        }
+    }
+    store_write_begin(); // Whole import is one transaction of the record store
+    int imported = import_csv_append(records, count);
+    store_write_end();
+    free(records);
+    if (imported < count) {
+        fprintf(stderr, "\n[Error] Memory allocation failure! Only %d of %d records imported!\n", imported, count);
+        return;
+    }
+    printf("\nCMS <IMPORT>: %d student records imported successfully!\n", imported);
+}
 
+// Write records to database file, printing the outcome to messages and failures to report
+void save_db(FILE* messages, FILE* report) {
+    // Write to a temporary file first so a crash mid-save never truncates the only copy of the database
+    FILE* file_ptr = fopen(TEMP_FILE_NAME, "wb");
+    if (!file_ptr) { // Handle file creation error
+        fprintf(report, "\n[Error] Unable to create temporary file \"%s\"! Changes not saved!\n", TEMP_FILE_NAME);
+        return;
     }
+    char* buffer = malloc(SAVE_BUFFER_SIZE);
+    if (!buffer) {
+        fprintf(report, "\n[Error] Memory allocation failure!\n");
+        fclose(file_ptr);
+        remove(TEMP_FILE_NAME);
+        return;
+    }
+    // Write new database file header
+    char* out = buffer;
+    out += sprintf(out, "==============================\n");
+    out += sprintf(out, "File Name: %s\n", FILE_NAME);
+    out += sprintf(out, "Database Name: %s\n", DB_NAME);
+    out += sprintf(out, "==============================\n");
+    out += sprintf(out, "[ID],[Name],[Programme],[Marks],[Grade]\n");
+
+    // Format records into buffer, flushing it whenever another record might not fit
+    int is_failed = 0;
+    size_t max_line = MAX_ID_LEN + MAX_NAME_LEN + MAX_PROGRAMME_LEN + 32; // Longest possible record line
     STUDENT_NODE* current = head;
-    while (current) {
-        fprintf(file_ptr, "%d,%s,%s,%.1f,%s\n", current->id, current->name, current->programme, current->marks, current->grade);
+    while (current && !is_failed) {
+        out = format_record_line(out, current);
+        if ((size_t)(buffer + SAVE_BUFFER_SIZE - out) < max_line) {
+            is_failed = fwrite(buffer, 1, out - buffer, file_ptr) != (size_t)(out - buffer);
+            out = buffer;
+        }
         current = current->next;
     }
+    if (!is_failed && out > buffer) {
+        is_failed = fwrite(buffer, 1, out - buffer, file_ptr) != (size_t)(out - buffer);
+    }
+    free(buffer);
+    if (!sync_and_close(file_ptr)) is_failed = 1; // Make sure data reached disk before replacing old file
 
-    fclose(file_ptr); // Close file after writing
+    // Atomically replace database file with the fully written temporary file
+    if (is_failed || !replace_file(TEMP_FILE_NAME, FILE_NAME)) {
+        fprintf(report, "\n[Error] Failed to write database file \"%s\"! Changes not saved!\n", FILE_NAME);
+        remove(TEMP_FILE_NAME);
+        return;
+    }
+    if (!wal_truncate()) { // Database file now holds every logged change, so the log starts over
+        fprintf(report, "\n[Error] Unable to reopen write-ahead log \"%s\"! Changes are only kept in memory until SAVE!\n", WAL_FILE_NAME);
+    }
     is_changes_made = 0; // Reset status for changes made
-    printf("\nCMS: Saved successfully to database file \"%s\"!\n", FILE_NAME);
+    is_snapshot_unsaved = 0;
+    fprintf(messages, "\nCMS: Saved successfully to database file \"%s\"!\n", FILE_NAME);
 }
 
 void close_db() {
+    // Changes are safe in the write-ahead log, compact them into database file (unless a snapshot replaced its records)
+    if (is_changes_made == 1 && wal.file && !is_snapshot_unsaved) {
+        wal_commit();
+        printf("\nCMS <CLOSE>: Writing %d logged changes into database file...\n", wal.logged);
+        save_db(stdout, stderr);
+        if (is_changes_made == 1) { // Save failed, keep database open so the log is not lost
+            printf("\nCMS <CLOSE>: Close operation cancelled! Changes remain in write-ahead log \"%s\"!\n", WAL_FILE_NAME);
+            return;
+        }
+    }
     if (is_changes_made == 1) {
         while (1) {
             printf("CMS <CLOSE>: You have unsaved changes! Are you sure you want to close the database file? (Y/N)\n>> P14_8: ");
@@ -904,12 +1943,14 @@ void close_db() {
             }
         }
     }
-    // If linked list is not empty, free its memory and reset node count
-    if (head != NULL) {
-        reset_list();
-    }
+    // Free linked list memory and ID index, and reset node count
+    store_write_begin();
+    reset_list();
+    store_write_end();
+    wal_close();
     is_file_open = 0; // Reset loaded file status
     is_changes_made = 0; // Reset changes made status
+    is_snapshot_unsaved = 0;
     printf("\nCMS: Database file \"%s\" successfully closed! Returning to the main menu!\n", FILE_NAME);
 }
 
@@ -947,29 +1988,36 @@ int get_id(int* id) {
     fgets(id_input, sizeof(id_input), stdin);
     clean_fgets(id_input);
 
-    if(id_input[0] == '0'){
-        fprintf(stderr, "\n[Error] Student ID cannot start with \"0\"! Please try again!\n");
-        return 0;
-    }
     // Check if user cancel operation
     if (strcasecmp(id_input, "Q") == 0) {
         return -1;
     }
 
     // Student ID validation
+    const char* error = check_id(id_input, id);
+    if (error) {
+        fprintf(stderr, "\n[Error] %s Please try again!\n", error);
+        return 0;
+    }
+    return 1;
+}
+
+// Validate student ID text and convert it into id, returns error message or NULL if valid
+const char* check_id(const char* id_input, int* id) {
+    if (id_input[0] == '0') {
+        return "Student ID cannot start with \"0\"!";
+    }
     int len = strlen(id_input);
     if (len == 0) {
-        fprintf(stderr, "\n[Error] Student ID cannot be empty! Please try again!\n");
-        return 0;
+        return "Student ID cannot be empty!";
     }
     if (!(len == MAX_ID_LEN && strspn(id_input, "0123456789") == MAX_ID_LEN)) {
-        fprintf(stderr, "\n[Error] Student ID must be exactly 7 numeric characters! Please try again!\n");
-        return 0;
+        return "Student ID must be exactly 7 numeric characters!";
     }
 
     // Valid student id input, convert string input to int, assign it to value of id pointer
     *id = atoi(id_input);
-    return 1;
+    return NULL;
 }
 
 int get_name(char* name) {
@@ -984,26 +2032,37 @@ int get_name(char* name) {
         return 0;
     }
     clean_fgets(name_input);
-    len = strlen(name_input);
     // Check if user cancel operation
     if (strcasecmp(name_input, "Q") == 0) {
         return -1;
     }
-    if (len == 0) {
-        fprintf(stderr, "\n[Error] Student name cannot be empty! Please try again!\n");
+    const char* error = check_name(name_input, name);
+    if (error) {
+        fprintf(stderr, "\n[Error] %s Please try again!\n", error);
         return 0;
     }
+    return 1;
+}
+
+// Validate student name text and copy it into name with extra spaces removed, returns error message or NULL if valid
+const char* check_name(char* name_input, char* name) {
+    int len = strlen(name_input);
+    if (len > MAX_NAME_LEN) {
+        return "Student name exceeds 30 character limit!";
+    }
+    if (len == 0) {
+        return "Student name cannot be empty!";
+    }
     for (int i = 0; i < len; i++) {
         if (!isalpha(name_input[i]) && !isspace(name_input[i])) {
-            fprintf(stderr, "\n[Error] Student name contains non-alphabet characters! Please try again!\n");
-            return 0;
+            return "Student name contains non-alphabet characters!";
         }
     }
 
     remove_extra_spaces(name_input);
     // Valid student name input, copy name input to value of name pointer
-    strncpy(name, name_input, MAX_NAME_LEN);
-    return 1;
+    strcpy(name, name_input);
+    return NULL;
 }
 
 int get_programme(char* programme) {
@@ -1019,15 +2078,28 @@ int get_programme(char* programme) {
         return 0;
     }
     clean_fgets(programme_input);
-    len = strlen(programme_input);
     // Check if user cancel operation
     if (strcasecmp(programme_input, "Q") == 0) {
         return -1;
     }
-    if (len == 0) {
-        fprintf(stderr, "\n[Error] Programme name cannot be empty! Please try again!\n");
+    const char* error = check_programme(programme_input, programme);
+    if (error) {
+        fprintf(stderr, "\n[Error] %s Please try again!\n", error);
         return 0;
     }
+    return 1;
+}
+
+// Validate programme name text and copy it into programme with extra spaces removed, returns error message or NULL if valid
+const char* check_programme(char* programme_input, char* programme) {
+    static char error[64]; // Message naming the invalid character
+    int len = strlen(programme_input);
+    if (len > MAX_PROGRAMME_LEN) {
+        return "Programme name exceeds 50 character limit!";
+    }
+    if (len == 0) {
+        return "Programme name cannot be empty!";
+    }
     for (int i = 0; i < len; i++) {
         if (!isalpha(programme_input[i]) &&
             !isspace(programme_input[i]) &&
@@ -1036,14 +2108,14 @@ int get_programme(char* programme) {
             programme_input[i] != '.' &&
             programme_input[i] != '(' &&
             programme_input[i] != ')') {
-            fprintf(stderr, "\n[Error] Programme name contains invalid character: \"%c\"! Please try again!\n", programme_input[i]);
-            return 0;
+            snprintf(error, sizeof(error), "Programme name contains invalid character: \"%c\"!", programme_input[i]);
+            return error;
         }
     }
     remove_extra_spaces(programme_input);
     // Valid programme name input, copy programme input to value of programme pointer
-    strncpy(programme, programme_input, MAX_PROGRAMME_LEN);
-    return 1;
+    strcpy(programme, programme_input);
+    return NULL;
 }
 
 int get_marks(float* marks) {
@@ -1057,11 +2129,20 @@ int get_marks(float* marks) {
     }
 
     // Marks input validation
+    const char* error = check_marks(marks_input, marks);
+    if (error) {
+        fprintf(stderr, "\n[Error] %s Please try again!\n", error);
+        return 0;
+    }
+    return 1;
+}
+
+// Validate marks text and convert it into marks rounded to 1 decimal place, returns error message or NULL if valid
+const char* check_marks(const char* marks_input, float* marks) {
     int len = strlen(marks_input);
     int dot_count = 0;
     if (len == 0) {
-        fprintf(stderr, "\n[Error] Marks cannot be empty! Please try again!\n");
-        return 0;
+        return "Marks cannot be empty!";
     }
     for (int i = 0; i < len; i++) {
         if (isdigit(marks_input[i])) {
@@ -1069,26 +2150,23 @@ int get_marks(float* marks) {
         }
         if (marks_input[i] == '.') {
             if (dot_count == 1) { // Only one dot allowed
-                fprintf(stderr, "\n[Error] Marks cannot contain multiple decimal points! Please try again!\n");
-                return 0;
+                return "Marks cannot contain multiple decimal points!";
             }
             dot_count++;
         }
         else { // Invalid characters present
-            fprintf(stderr, "\n[Error] Invalid marks format! Marks must be between 0.0 and 100.0! Please try again!\n");
-            return 0;
+            return "Invalid marks format! Marks must be between 0.0 and 100.0!";
         }
     }
     float temp_marks = atof(marks_input); // Convert string to float after validation
     if (temp_marks < 0.0 || temp_marks > 100.0) { // Check range
-        fprintf(stderr, "\n[Error] Marks must be between 0.0 and 100.0! Please try again.\n");
-        return 0;
+        return "Marks must be between 0.0 and 100.0!";
     }
 
     // Valid marks input, assign to value of marks pointer
     temp_marks = round(temp_marks * 10) / 10; // Round to 1 decimal place
     *marks = temp_marks;
-    return 1;
+    return NULL;
 }
 
 // Prompts and validates user input for 'y' or 'n', returns status
@@ -1107,66 +2185,1033 @@ int get_choice() {
 }
 
 // Determine student grade based on marks
-char* calculate_grade(float marks) {
-    if (marks >= 85) return "A+";
-    if (marks >= 80) return "A";
-    if (marks >= 75) return "A-";
-    if (marks >= 70) return "B+";
-    if (marks >= 65) return "B";
-    if (marks >= 60) return "B-";
-    if (marks >= 55) return "C+";
-    if (marks >= 50) return "C";
-    if (marks >= 45) return "D+";
-    if (marks >= 40) return "D";
-    if (marks >= 0) return "F";
+const char* calculate_grade(float marks) {
+    return grade_name(calculate_grade_code(marks));
+}
+
+// Determine student grade code based on marks
+GRADE calculate_grade_code(float marks) {
+    if (marks >= 85) return GRADE_A_PLUS;
+    if (marks >= 80) return GRADE_A;
+    if (marks >= 75) return GRADE_A_MINUS;
+    if (marks >= 70) return GRADE_B_PLUS;
+    if (marks >= 65) return GRADE_B;
+    if (marks >= 60) return GRADE_B_MINUS;
+    if (marks >= 55) return GRADE_C_PLUS;
+    if (marks >= 50) return GRADE_C;
+    if (marks >= 45) return GRADE_D_PLUS;
+    if (marks >= 40) return GRADE_D;
+    return GRADE_F;
+}
+
+// Grade text for a code stored in a node
+const char* grade_name(int grade) {
+    return GRADE_NAMES[grade];
 }
 
 // Reset linked list by deallocating memory for nodes and resetting node count
 void reset_list() {
     node_count = 0; // Reset node count (counter tracking number of nodes in list)
-    STUDENT_NODE* current = head; // Initialize pointer to access linked list starting from head
-    while (current) { // Loop until end of list
-        STUDENT_NODE* temp = current;
-        current = current->next; // Move to next node in linked list
-        free(temp); // Free up memory for temp (previous "current" node)
-    }
+    table_free(); // Nodes live in the record table, so releasing its segments frees every node at once
     head = NULL; // Reset head pointer to NULL as list is now empty
+    tail = NULL; // Reset tail pointer to NULL as list is now empty
+    id_index_free(); // Tear down ID index along with the nodes it points to
+    dict_free(&programme_dict); // Programme codes are only meaningful for the closed database
+    name_index_free(); // Postings refer to slots of the freed record table
+    id_suffix_free();
+    sorted_orders_free();
+    stats_table_free();
+    query_cache_free();
+    node_buckets_free(grade_buckets, GRADE_COUNT);
+    node_buckets_free(marks_buckets, MARKS_BUCKETS);
 }
 
-// Skip header information for database (assume file pointer is already validated)
-void skip_header_lines(FILE* file_ptr) {
-    char buffer[128]; // Buffer to read and discard metadata
-    for (int i = 0; i < FILE_HEADER_LINES; i++) {
-        if (!fgets(buffer, sizeof(buffer), file_ptr)) {
-            fprintf(stderr, "\n[Error] Reached EOF or encountered error while skipping header lines!\n");
-            break;
-        };
-    }
+// Hash student ID for the ID index (Fibonacci hashing spreads sequential IDs)
+// Top ID_INDEX_SHARD_BITS bits pick the shard, low bits the slot within it
+static unsigned int id_index_hash(int id) {
+    return (unsigned int)id * 2654435769u;
 }
 
-void display_press_enter() {
-    printf(">> P14_8: Press [Enter] to continue..");
-    while (getchar() != '\n'); // Wait for user to press Enter
-    printf("\n");
+// Shard of the ID index holding id
+static ID_INDEX_SHARD* id_index_shard(int id) {
+    return &id_index.shards[id_index_hash(id) >> (32 - ID_INDEX_SHARD_BITS)];
 }
 
-void clean_fgets(char* input) {
-    // Check for input overflow before trimming as trimming would affect input[len - 1]
-    int len = strlen(input);
-    int has_overflow = len > 0 && input[len - 1] != '\n';
-
-    // Trim any leading and trailing white spaces
-    char* start = input; // Initialize pointer to start of input
-    while (isspace((unsigned char)*start)) {
-        start++;  // Move start pointer forward passing any leading white space
+// Set up shard locks once at start-up, before any thread uses the ID index
+void id_index_locks_init() {
+    for (int i = 0; i < ID_INDEX_SHARDS; i++) {
+        pthread_mutex_init(&id_index.shards[i].lock, NULL);
     }
+}
 
-    // Handle case where input is only spaces
-    if (*start == '\0') {
-        input[0] = '\0';  // Empty the string
-        return;
+// Allocate an empty ID index sized for expected number of records, returns 0 on allocation failure
+int id_index_init(int expected_count) {
+    int capacity = 16;
+    while (capacity * ID_INDEX_SHARDS < expected_count * 2) { // Keep load factor at or below 50% after initial build
+        capacity *= 2;
     }
-    char* end = start + strlen(start) - 1; // Initialize end pointer
+    STUDENT_NODE** slots[ID_INDEX_SHARDS];
+    for (int i = 0; i < ID_INDEX_SHARDS; i++) { // Allocate all shards before discarding anything
+        slots[i] = calloc(capacity, sizeof(STUDENT_NODE*));
+        if (!slots[i]) {
+            while (i > 0) free(slots[--i]);
+            return 0;
+        }
+    }
+    for (int i = 0; i < ID_INDEX_SHARDS; i++) {
+        ID_INDEX_SHARD* shard = &id_index.shards[i];
+        pthread_mutex_lock(&shard->lock);
+        free(shard->slots); // Discard any previous index
+        shard->slots = slots[i];
+        shard->capacity = capacity;
+        shard->count = 0;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return 1;
+}
+
+// Find slot position of id in shard, or of the empty slot ending its probe sequence (caller holds shard lock)
+static unsigned int id_index_probe(const ID_INDEX_SHARD* shard, int id) {
+    unsigned int mask = shard->capacity - 1;
+    unsigned int pos = id_index_hash(id) & mask;
+    while (shard->slots[pos] && shard->slots[pos]->id != id) { // Probe until an empty slot ends the cluster
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+// Find student node by ID in O(1) average time, returns NULL if not found
+STUDENT_NODE* id_index_find(int id) {
+    ID_INDEX_SHARD* shard = id_index_shard(id);
+    pthread_mutex_lock(&shard->lock);
+    STUDENT_NODE* node = shard->slots ? shard->slots[id_index_probe(shard, id)] : NULL;
+    pthread_mutex_unlock(&shard->lock);
+    return node;
+}
+
+// Double shard capacity and reinsert its nodes, returns 0 on allocation failure (caller holds shard lock)
+static int id_index_grow(ID_INDEX_SHARD* shard) {
+    int new_capacity = shard->capacity ? shard->capacity * 2 : 16;
+    STUDENT_NODE** new_slots = calloc(new_capacity, sizeof(STUDENT_NODE*));
+    if (!new_slots) return 0;
+    unsigned int mask = new_capacity - 1;
+    for (int i = 0; i < shard->capacity; i++) {
+        STUDENT_NODE* node = shard->slots[i];
+        if (!node) continue;
+        unsigned int pos = id_index_hash(node->id) & mask;
+        while (new_slots[pos]) pos = (pos + 1) & mask;
+        new_slots[pos] = node;
+    }
+    free(shard->slots);
+    shard->slots = new_slots;
+    shard->capacity = new_capacity;
+    return 1;
+}
+
+// Add node to the ID index unless its ID is already present, checked and inserted under one shard lock
+// Returns 1 if inserted, 0 on allocation failure and -1 if another node holds the ID
+int id_index_insert(STUDENT_NODE* node) {
+    ID_INDEX_SHARD* shard = id_index_shard(node->id);
+    int status = 1;
+    pthread_mutex_lock(&shard->lock);
+    if (shard->slots && shard->slots[id_index_probe(shard, node->id)]) status = -1;
+    // Grow before load factor exceeds 70% to keep probe sequences short
+    else if ((shard->count + 1) * 10 > shard->capacity * 7 && !id_index_grow(shard)) status = 0;
+    else {
+        shard->slots[id_index_probe(shard, node->id)] = node;
+        shard->count++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return status;
+}
+
+// Remove student ID from the index using backward shift deletion (no tombstones left behind)
+// Returns the removed node, or NULL if the ID was not in the index
+STUDENT_NODE* id_index_remove(int id) {
+    ID_INDEX_SHARD* shard = id_index_shard(id);
+    pthread_mutex_lock(&shard->lock);
+    STUDENT_NODE* node = NULL;
+    if (shard->slots) {
+        unsigned int mask = shard->capacity - 1;
+        unsigned int pos = id_index_probe(shard, id);
+        node = shard->slots[pos];
+        if (node) {
+            shard->slots[pos] = NULL;
+            shard->count--;
+            // Shift later entries of the cluster back if the freed slot lies on their probe path
+            unsigned int next = (pos + 1) & mask;
+            while (shard->slots[next]) {
+                unsigned int home = id_index_hash(shard->slots[next]->id) & mask;
+                if (((next - home) & mask) >= ((next - pos) & mask)) {
+                    shard->slots[pos] = shard->slots[next];
+                    shard->slots[next] = NULL;
+                    pos = next;
+                }
+                next = (next + 1) & mask;
+            }
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return node;
+}
+
+// Number of IDs in the index
+int id_index_count() {
+    int count = 0;
+    for (int i = 0; i < ID_INDEX_SHARDS; i++) {
+        pthread_mutex_lock(&id_index.shards[i].lock);
+        count += id_index.shards[i].count;
+        pthread_mutex_unlock(&id_index.shards[i].lock);
+    }
+    return count;
+}
+
+// Release ID index memory
+void id_index_free() {
+    for (int i = 0; i < ID_INDEX_SHARDS; i++) {
+        ID_INDEX_SHARD* shard = &id_index.shards[i];
+        pthread_mutex_lock(&shard->lock);
+        free(shard->slots);
+        shard->slots = NULL;
+        shard->capacity = 0;
+        shard->count = 0;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+// Number of slots in given record table segment
+int table_segment_size(int segment) {
+    return TABLE_FIRST_SEGMENT << segment;
+}
+
+// Find node stored at given slot of the record table
+STUDENT_NODE* table_node(int slot) {
+    int segment = 0;
+    while (slot >= table_segment_size(segment)) { // Segment k starts after all smaller segments
+        slot -= table_segment_size(segment);
+        segment++;
+    }
+    return &record_table.segments[segment].nodes[slot];
+}
+
+// Find ID digits of given slot in the ID digits column
+const char* table_id_digits(int slot) {
+    int segment = 0;
+    while (slot >= table_segment_size(segment)) {
+        slot -= table_segment_size(segment);
+        segment++;
+    }
+    return record_table.segments[segment].id_digits + (size_t)slot * ID_DIGITS_LEN;
+}
+
+// Hand out a slot of the record table, recycling deleted slots first, returns NULL on allocation failure
+STUDENT_NODE* table_alloc_node() {
+    STUDENT_NODE* node;
+    if (record_table.free_list) { // Reuse most recently deleted slot
+        node = record_table.free_list;
+        record_table.free_list = node->next;
+        record_table.free_count--;
+    }
+    else {
+        int capacity = TABLE_FIRST_SEGMENT * ((1 << record_table.segment_count) - 1); // Total slots of all segments
+        if (record_table.used == capacity) { // Table full, add a segment twice the size of the last one
+            if (record_table.segment_count == TABLE_MAX_SEGMENTS) return NULL;
+            size_t size = table_segment_size(record_table.segment_count);
+            size_t bytes = size * (sizeof(STUDENT_NODE) + ID_DIGITS_LEN);
+            char* block = malloc(bytes); // One allocation holds rows and the ID digits column
+            if (!block) return NULL;
+            RECORD_SEGMENT* segment = &record_table.segments[record_table.segment_count];
+            segment->nodes = (STUDENT_NODE*)block;
+            segment->id_digits = block + size * sizeof(STUDENT_NODE);
+            memset(segment->id_digits, 0, size * ID_DIGITS_LEN);
+            for (size_t i = 0; i < size; i++) { // Snapshot readers skip slots never handed out
+                segment->nodes[i].write_seq = 0; // Kept across reuse of the slot so readers always notice changes
+                segment->nodes[i].created_version = 0;
+                segment->nodes[i].deleted_version = 1;
+            }
+            __atomic_store_n(&record_table.segment_count, record_table.segment_count + 1, __ATOMIC_RELEASE); // Snapshot readers scan new segments only once set up
+            record_table.bytes_reserved += bytes;
+        }
+        node = table_node(record_table.used);
+        node->slot = record_table.used;
+        __atomic_store_n(&record_table.used, record_table.used + 1, __ATOMIC_RELEASE);
+    }
+    // Becomes visible to snapshot readers when the transaction allocating it is published
+    __atomic_store_n(&node->write_seq, node->write_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    node->created_version = store.pending_version;
+    node->deleted_version = 0;
+    node->fields_version = store.pending_version;
+    node->older = NULL;
+    node->seq = record_table.next_seq++;
+    __atomic_store_n(&node->write_seq, node->write_seq + 1, __ATOMIC_RELEASE);
+    return node;
+}
+
+// Return node slot to the record table free list so the next allocation recycles it
+void table_release_node(STUDENT_NODE* node) {
+    if (node->deleted_version == 0) { // Never linked, hide it from snapshot readers
+        __atomic_store_n(&node->write_seq, node->write_seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        node->deleted_version = node->created_version;
+        __atomic_store_n(&node->write_seq, node->write_seq + 1, __ATOMIC_RELEASE);
+    }
+    node->id = 0;
+    table_sync_columns(node); // Mark slot as empty in ID digits column
+    if (node->slot == record_table.used - 1) { // Most recent slot simply lowers the high-water mark
+        record_table.used--;
+        return;
+    }
+    node->next = record_table.free_list;
+    record_table.free_list = node;
+    record_table.free_count++;
+}
+
+// Copy ID digits of node into the ID digits column of its segment
+void table_sync_columns(STUDENT_NODE* node) {
+    int slot = node->slot;
+    int segment = 0;
+    while (slot >= table_segment_size(segment)) {
+        slot -= table_segment_size(segment);
+        segment++;
+    }
+    char* digits = record_table.segments[segment].id_digits + (size_t)slot * ID_DIGITS_LEN;
+    memset(digits, 0, ID_DIGITS_LEN);
+    if (node->id > 0 && node->id <= 9999999) format_int(digits, node->id); // At most MAX_ID_LEN digits, leaving a null pad byte
+}
+
+// Release every record table segment, freeing all nodes with one call per segment
+void table_free() {
+    for (int i = 0; i < record_table.segment_count; i++) {
+        free(record_table.segments[i].nodes); // Columns share the block allocated for nodes
+        record_table.segments[i].nodes = NULL;
+        record_table.segments[i].id_digits = NULL;
+    }
+    record_table.segment_count = 0;
+    record_table.used = 0;
+    store.retired_nodes = NULL; // Retired nodes lived in the freed segments
+    store.retired_nodes_tail = NULL;
+    store_free_versions();
+    record_table.free_list = NULL;
+    record_table.free_count = 0;
+    record_table.next_seq = 0;
+    record_table.bytes_reserved = 0;
+}
+
+// Order nodes by insertion order for qsort
+int compare_node_seq(const void* a, const void* b) {
+    unsigned int seq_a = (*(STUDENT_NODE* const*)a)->seq;
+    unsigned int seq_b = (*(STUDENT_NODE* const*)b)->seq;
+    return (seq_a > seq_b) - (seq_a < seq_b);
+}
+
+// Write record table arena usage to file, showing how much reserved memory is held by deleted slots
+void write_memory_stats(FILE* file) {
+    size_t slot_bytes = sizeof(STUDENT_NODE) + ID_DIGITS_LEN;
+    int capacity = TABLE_FIRST_SEGMENT * ((1 << record_table.segment_count) - 1);
+    int live_slots = record_table.used - record_table.free_count;
+    fprintf(file, "\n============= MEMORY USAGE =============\n");
+    fprintf(file, "%-22s %d\n", "Segments:", record_table.segment_count);
+    fprintf(file, "%-22s %d\n", "Slots reserved:", capacity);
+    fprintf(file, "%-22s %d\n", "Slots live:", live_slots);
+    fprintf(file, "%-22s %d\n", "Slots free (deleted):", record_table.free_count);
+    fprintf(file, "%-22s %d\n", "Slots never used:", capacity - record_table.used);
+    fprintf(file, "%-22s %zu\n", "Bytes reserved:", record_table.bytes_reserved);
+    fprintf(file, "%-22s %zu\n", "Bytes live:", live_slots * slot_bytes);
+    fprintf(file, "%-22s %.1f%%\n", "Fragmentation:", record_table.used ? 100.0 * record_table.free_count / record_table.used : 0.0);
+    fprintf(file, "========================================\n");
+    fprintf(file, "CMS <MEMORY>: %d records stored in \"%s\" database!\n", node_count, DB_NAME);
+}
+
+// Skip header information for database, returns start of first record line
+const char* skip_header_lines(const char* data, const char* end) {
+    for (int i = 0; i < FILE_HEADER_LINES; i++) {
+        const char* line_end = memchr(data, '\n', end - data);
+        if (!line_end) {
+            fprintf(stderr, "\n[Error] Reached EOF or encountered error while skipping header lines!\n");
+            return end;
+        }
+        data = line_end + 1;
+    }
+    return data;
+}
+
+// Map database file into memory for zero-copy parsing, returns NULL if file cannot be opened
+char* map_file(const char* file_name, size_t* size) {
+    static char empty_file[1] = ""; // Mapping a zero-length file is not allowed, hand out an empty buffer instead
+#ifdef _WIN32
+    FILE* file_ptr = fopen(file_name, "rb");
+    if (!file_ptr) return NULL;
+    fseek(file_ptr, 0, SEEK_END);
+    long file_size = ftell(file_ptr);
+    fseek(file_ptr, 0, SEEK_SET);
+    if (file_size <= 0) {
+        fclose(file_ptr);
+        *size = 0;
+        return empty_file;
+    }
+    char* data = malloc(file_size);
+    if (!data) {
+        fclose(file_ptr);
+        return NULL;
+    }
+    *size = fread(data, 1, file_size, file_ptr); // Read whole file with a single call
+    fclose(file_ptr);
+    return data;
+#else
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0) {
+        close(fd);
+        return NULL;
+    }
+    *size = file_stat.st_size;
+    if (*size == 0) {
+        close(fd);
+        return empty_file;
+    }
+    char* data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // Mapping stays valid after descriptor is closed
+    if (data == MAP_FAILED) return NULL;
+    madvise(data, *size, MADV_SEQUENTIAL); // File is parsed front to back once
+    return data;
+#endif
+}
+
+// Release memory returned by map_file
+void unmap_file(char* data, size_t size) {
+    if (size == 0) return; // Empty file was never mapped
+#ifdef _WIN32
+    free(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+// Parse "[ID],[Name],[Programme],[Marks],[Grade]" between line and end into record without stdio
+// Applies the same limits as the former "%7d,%30[^,],%50[^,],%f,%s" format but only takes marks check_marks would accept, returns 0 if line is malformed
+int parse_record_line(const char* line, const char* end, STUDENT_RECORD* record) {
+    const char* p = line;
+    while (p < end && isspace((unsigned char)*p)) p++;
+
+    // Student ID: 1 to MAX_ID_LEN digits followed by a comma
+    int id = 0, digits = 0;
+    while (p < end && isdigit((unsigned char)*p) && digits < MAX_ID_LEN) {
+        id = id * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (digits == 0 || p == end || *p != ',') return 0;
+    p++;
+
+    // Name and programme: non-empty text up to the next comma within length limits
+    const char* comma = memchr(p, ',', end - p);
+    if (!comma || comma == p || comma - p > MAX_NAME_LEN) return 0;
+    memcpy(record->name, p, comma - p);
+    record->name[comma - p] = '\0';
+    p = comma + 1;
+    comma = memchr(p, ',', end - p);
+    if (!comma || comma == p || comma - p > MAX_PROGRAMME_LEN) return 0;
+    memcpy(record->programme, p, comma - p);
+    record->programme[comma - p] = '\0';
+    p = comma + 1;
+
+    // Marks: 0 to 100 with at most one decimal place, the range check_marks accepts, accumulated in tenths
+    while (p < end && isspace((unsigned char)*p)) p++;
+    int tenths = 0, mark_digits = 0;
+    while (p < end && isdigit((unsigned char)*p) && mark_digits < 3) {
+        tenths = tenths * 10 + (*p++ - '0');
+        mark_digits++;
+    }
+    tenths *= 10;
+    if (p < end && *p == '.') {
+        p++;
+        if (p < end && isdigit((unsigned char)*p)) tenths += *p++ - '0';
+    }
+    if (mark_digits == 0 || tenths > 1000 || p == end || *p != ',') return 0;
+    record->marks = (float)(tenths / 10.0);
+    p++;
+
+    // Grade: one or two non-space characters, trailing whitespace (e.g. "\r") is allowed
+    while (p < end && isspace((unsigned char)*p)) p++;
+    int grade_len = 0;
+    while (p < end && !isspace((unsigned char)*p)) {
+        if (grade_len == 2) return 0;
+        record->grade[grade_len++] = *p++;
+    }
+    if (grade_len == 0) return 0;
+    record->grade[grade_len] = '\0';
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p != end) return 0;
+
+    record->id = id;
+    return 1;
+}
+
+// Add filled node to end of linked list and index it, returns 0 on allocation failure
+int append_node(STUDENT_NODE* node) {
+    if (!bucket_indexes_add(node)) return 0; // Add node to its grade bucket and the marks index
+    if (id_index_insert(node) != 1) { // Index node by student ID, callers have already rejected duplicates
+        bucket_indexes_remove(node);
+        return 0;
+    }
+    node->next = NULL;
+    node->prev = tail; // Previous node is the current tail (NULL if list is empty)
+    if (head == NULL) { // Linked list is empty
+        head = node;
+    }
+    else { // Linked list has elements
+        tail->next = node; // Point current tail to new node
+    }
+    tail = node;
+    node_count++;
+    table_sync_columns(node); // Fill ID digits column
+    if (name_index.is_built && !name_index_add(node)) name_index_free(); // Fall back to scanning rather than miss the node
+    if (id_suffix_index.is_built) id_suffix_add(node);
+    sorted_orders_add(node);
+    programme_stats_add(node);
+    for (int field = 0; field < QUERY_FIELD_COUNT; field++) column_versions_bump(field); // New record may match any lookup
+    return 1;
+}
+
+// Atomically rename fully written temporary file over file_name and persist the rename, returns 0 on failure
+int replace_file(const char* temp_file_name, const char* file_name) {
+#ifdef _WIN32
+    return MoveFileExA(temp_file_name, file_name, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(temp_file_name, file_name) != 0) return 0;
+    int dir_fd = open(".", O_RDONLY); // Persist the rename itself by syncing the directory entry
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return 1;
+#endif
+}
+
+// Replace fields of node with new values, recomputing grade and the ID digits column
+// Returns 0 and leaves node unchanged if programme could not be added to the dictionary or node to its new buckets
+int update_node(STUDENT_NODE* node, const char* name, const char* programme, float marks) {
+    int code = dict_intern(&programme_dict, programme);
+    if (code < 0 || code > 0xFFFF) return 0;
+    int is_linked = id_index_find(node->id) == node; // Nodes not appended yet are indexed by append_node instead
+    if (is_linked && node->fields_version != store.pending_version) { // Keep values seen by older snapshots
+        RECORD_VERSION* version = malloc(sizeof(RECORD_VERSION));
+        if (!version) return 0;
+        strcpy(version->name, node->name);
+        version->programme_code = node->programme_code;
+        version->grade = node->grade;
+        version->marks = node->marks;
+        version->fields_version = node->fields_version;
+        version->end_version = store.pending_version;
+        version->older = node->older;
+        version->next_retired = NULL;
+        if (store.retired_versions_tail) store.retired_versions_tail->next_retired = version;
+        else store.retired_versions = version;
+        store.retired_versions_tail = version;
+        node->older = version;
+    }
+    GRADE grade = calculate_grade_code(marks);
+    // Compared before any field is replaced, lookups on a column only go stale if its value changed
+    int is_name_changed = is_linked && strcmp(node->name, name) != 0; // Nodes not appended yet hold no fields
+    int is_programme_changed = is_linked && node->programme_code != code;
+    int is_marks_changed = is_linked && node->marks != marks;
+    int is_grade_changed = is_linked && node->grade != grade;
+    if (is_linked) { // Taken out under the old keys, put back under the new ones
+        sorted_orders_remove(node);
+        programme_stats_remove(node);
+    }
+    __atomic_store_n(&node->write_seq, node->write_seq + 1, __ATOMIC_RELAXED); // Snapshot readers retry until fields are consistent
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    node->fields_version = store.pending_version;
+    if (is_linked && (grade != node->grade || marks_bucket(marks) != marks_bucket(node->marks))) {
+        GRADE old_grade = node->grade;
+        float old_marks = node->marks;
+        bucket_indexes_remove(node);
+        node->grade = grade;
+        node->marks = marks;
+        if (!bucket_indexes_add(node)) {
+            node->grade = old_grade;
+            node->marks = old_marks;
+            bucket_indexes_add(node); // Cannot fail, the old buckets just shrank
+            sorted_orders_add(node);
+            programme_stats_add(node);
+            __atomic_store_n(&node->write_seq, node->write_seq + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+    if (is_name_changed) column_versions_bump(QUERY_NAME);
+    if (is_programme_changed) column_versions_bump(QUERY_PROGRAMME);
+    if (is_marks_changed) column_versions_bump(QUERY_MARKS);
+    if (is_grade_changed) column_versions_bump(QUERY_GRADE);
+    node->grade = grade;
+    if (node->name != name) {
+        int is_renamed = name_index.is_built && is_name_changed;
+        if (is_renamed) name_index_forget(node);
+        strncpy(node->name, name, MAX_NAME_LEN);
+        node->name[MAX_NAME_LEN] = '\0';
+        if (is_renamed && !name_index_add(node)) name_index_free();
+    }
+    node->programme_code = code;
+    node->marks = marks;
+    __atomic_store_n(&node->write_seq, node->write_seq + 1, __ATOMIC_RELEASE);
+    table_sync_columns(node);
+    if (is_linked) {
+        sorted_orders_add(node);
+        programme_stats_add(node);
+    }
+    return 1;
+}
+
+// Copy parsed record into node as loaded, returns 0 on allocation failure
+// Grade is recalculated from marks, so a hand-edited grade that disagrees with the marks is corrected
+int fill_node(STUDENT_NODE* node, const STUDENT_RECORD* record) {
+    int code = dict_intern(&programme_dict, record->programme);
+    if (code < 0 || code > 0xFFFF) return 0;
+    node->id = record->id;
+    strcpy(node->name, record->name);
+    node->programme_code = code;
+    node->marks = record->marks;
+    node->grade = calculate_grade_code(record->marks);
+    return 1;
+}
+
+// Programme name for a code stored in a node
+const char* programme_name(int code) {
+    return programme_dict.strings[code];
+}
+
+// Unlink node from linked list, drop it from the ID index and return its slot to the record table
+void remove_node(STUDENT_NODE* node) {
+    if (node->prev == NULL) { // Indicates that head node is the matched node
+        head = node->next; // Delete node which is head
+    }
+    else {
+        node->prev->next = node->next; // Delete node
+    }
+    if (node->next == NULL) { // Update tail if the last node happens to be matched node
+        tail = node->prev; // Becomes NULL if the list is now empty
+    }
+    else {
+        node->next->prev = node->prev; // Relink next node to node before deleted node
+    }
+    id_index_remove(node->id);
+    bucket_indexes_remove(node);
+    if (name_index.is_built) name_index_forget(node);
+    if (id_suffix_index.is_built) id_suffix_remove(node); // Before release clears the ID digits
+    sorted_orders_remove(node); // Before fields change, positions are found by the node's keys
+    programme_stats_remove(node);
+    table_retire_node(node); // Slot is released once no snapshot reader can see the node
+    for (int field = 0; field < QUERY_FIELD_COUNT; field++) column_versions_bump(field); // Lookups may have listed it
+    node_count--;
+}
+
+// Load student records from file body line by line on the calling thread
+void load_records(const char* data, const char* end) {
+    const char* line = data;
+    int line_number = FILE_HEADER_LINES;
+    while (line < end) {
+        const char* line_end = memchr(line, '\n', end - line); // Find end of current line
+        if (!line_end) line_end = end; // Last line has no trailing newline
+        const char* next_line = line_end + 1;
+        line_number++;
+
+        const char* field = line;
+        while (field < line_end && isspace((unsigned char)*field)) field++;
+        if (field == line_end) { // Skip blank lines
+            line = next_line;
+            continue;
+        }
+
+        // Split line into fields based on commas
+        STUDENT_RECORD record;
+        if (!parse_record_line(line, line_end, &record)) { // Ensure proper fields
+            fprintf(stderr, "\n[Error] Malformed line %d in \"%s\" database!\n", line_number, DB_NAME);
+            line = next_line;
+            continue;
+        }
+        line = next_line;
+        if (id_index_find(record.id)) { // Student ID must stay unique for the index
+            fprintf(stderr, "\n[Error] Duplicate student ID=\"%d\" in \"%s\" database! Record skipped!\n", record.id, DB_NAME);
+            continue;
+        }
+
+        STUDENT_NODE* new_student_node = table_alloc_node(); // Take next slot in record table for new student node
+        if (!new_student_node) {
+            fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+            return;
+        }
+        if (!fill_node(new_student_node, &record) || !append_node(new_student_node)) { // Insert new student node to back of linked list
+            fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+            table_release_node(new_student_node);
+            return;
+        }
+    }
+}
+
+// Load student records by parsing newline-aligned chunks on worker threads, then merging them in file order
+void load_records_parallel(const char* data, const char* end) {
+    int chunk_count = worker_thread_count * LOAD_CHUNKS_PER_THREAD;
+    if ((end - data) / chunk_count < LOAD_MIN_CHUNK_BYTES) {
+        chunk_count = (int)((end - data) / LOAD_MIN_CHUNK_BYTES) + 1;
+    }
+    LOAD_JOB job;
+    job.chunks = calloc(chunk_count, sizeof(LOAD_CHUNK));
+    pthread_t* threads = malloc(worker_thread_count * sizeof(pthread_t));
+    if (!job.chunks || !threads) {
+        free(job.chunks);
+        free(threads);
+        load_records(data, end); // Not enough memory for chunk bookkeeping, parse on this thread
+        return;
+    }
+
+    // Cut body into chunks of roughly equal size, moving each cut forward to the next line start
+    const char* chunk_start = data;
+    job.chunk_count = 0;
+    for (int i = 0; i < chunk_count && chunk_start < end; i++) {
+        const char* chunk_end = data + (end - data) * (i + 1) / chunk_count;
+        if (chunk_end < chunk_start) chunk_end = chunk_start;
+        if (chunk_end < end) {
+            const char* newline = memchr(chunk_end, '\n', end - chunk_end);
+            chunk_end = newline ? newline + 1 : end;
+        }
+        job.chunks[job.chunk_count].start = chunk_start;
+        job.chunks[job.chunk_count].end = chunk_end;
+        job.chunk_count++;
+        chunk_start = chunk_end;
+    }
+
+    // Parse chunks on thread pool
+    job.next_chunk = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    int thread_count = 0;
+    for (int i = 0; i < worker_thread_count && i < job.chunk_count; i++) {
+        if (pthread_create(&threads[thread_count], NULL, load_worker, &job) != 0) break;
+        thread_count++;
+    }
+    load_worker(&job); // Calling thread helps, and finishes the job alone if no thread could start
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&job.lock);
+    free(threads);
+
+    // Size ID index for all parsed records up front, then merge chunks in file order
+    int total_entries = 0;
+    for (int i = 0; i < job.chunk_count; i++) {
+        total_entries += job.chunks[i].entry_count;
+    }
+    id_index_init(total_entries); // On failure the existing empty index still grows on demand
+    int first_line = FILE_HEADER_LINES + 1; // File line number of first line in current chunk
+    int is_failed = 0;
+    for (int i = 0; i < job.chunk_count; i++) {
+        LOAD_CHUNK* chunk = &job.chunks[i];
+        if (chunk->is_failed) is_failed = 1;
+        for (int j = 0; j < chunk->entry_count && !is_failed; j++) {
+            LOAD_ENTRY* entry = &chunk->entries[j];
+            if (!entry->is_valid) {
+                fprintf(stderr, "\n[Error] Malformed line %d in \"%s\" database!\n", first_line + entry->line_offset, DB_NAME);
+                continue;
+            }
+            if (id_index_find(entry->record.id)) { // Student ID must stay unique for the index
+                fprintf(stderr, "\n[Error] Duplicate student ID=\"%d\" in \"%s\" database! Record skipped!\n", entry->record.id, DB_NAME);
+                continue;
+            }
+            STUDENT_NODE* new_student_node = table_alloc_node();
+            if (!new_student_node) {
+                is_failed = 1;
+                break;
+            }
+            if (!fill_node(new_student_node, &entry->record) || !append_node(new_student_node)) {
+                table_release_node(new_student_node);
+                is_failed = 1;
+            }
+        }
+        first_line += chunk->line_count;
+        free(chunk->entries);
+    }
+    if (is_failed) {
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+    }
+    free(job.chunks);
+}
+
+// Worker thread body: take chunks from the job queue and parse their lines into entry buffers
+void* load_worker(void* arg) {
+    LOAD_JOB* job = arg;
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        int index = job->next_chunk++;
+        pthread_mutex_unlock(&job->lock);
+        if (index >= job->chunk_count) break;
+
+        LOAD_CHUNK* chunk = &job->chunks[index];
+        int capacity = (int)((chunk->end - chunk->start) / 48) + 16; // Estimate from typical line length
+        chunk->entries = malloc(capacity * sizeof(LOAD_ENTRY));
+        if (!chunk->entries) {
+            chunk->is_failed = 1;
+            continue;
+        }
+        const char* line = chunk->start;
+        while (line < chunk->end) {
+            const char* line_end = memchr(line, '\n', chunk->end - line);
+            if (!line_end) line_end = chunk->end;
+            int line_offset = chunk->line_count++;
+
+            const char* field = line;
+            while (field < line_end && isspace((unsigned char)*field)) field++;
+            if (field != line_end) { // Skip blank lines
+                if (chunk->entry_count == capacity) {
+                    capacity *= 2;
+                    LOAD_ENTRY* entries = realloc(chunk->entries, capacity * sizeof(LOAD_ENTRY));
+                    if (!entries) {
+                        chunk->is_failed = 1;
+                        break;
+                    }
+                    chunk->entries = entries;
+                }
+                LOAD_ENTRY* entry = &chunk->entries[chunk->entry_count++];
+                entry->line_offset = line_offset;
+                entry->is_valid = parse_record_line(line, line_end, &entry->record);
+            }
+            line = line_end + 1;
+        }
+    }
+    return NULL;
+}
+
+// Write decimal digits of non-negative value to out, returns end of written text
+char* format_int(char* out, int value) {
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+// Round non-negative marks to a whole number of tenths exactly as "%.1f" would
+int marks_to_tenths(float marks) {
+    double tenths = (double)marks * 10; // Exact, a float has few enough mantissa bits
+    double whole = floor(tenths);
+    double fraction = tenths - whole;
+    // Round half to even like printf does for values that sit exactly between two tenths
+    if (fraction > 0.5 || (fraction == 0.5 && fmod(whole, 2) != 0)) whole++;
+    return (int)whole;
+}
+
+// Write non-negative marks with one decimal place to out exactly as "%.1f" would, returns end of written text
+char* format_marks(char* out, float marks) {
+    int value = marks_to_tenths(marks);
+    out = format_int(out, value / 10);
+    *out++ = '.';
+    *out++ = '0' + value % 10;
+    return out;
+}
+
+// Write record as a database file line "[ID],[Name],[Programme],[Marks],[Grade]\n", returns end of written text
+char* format_record_line(char* out, const STUDENT_NODE* node) {
+    size_t len;
+    out = format_int(out, node->id);
+    *out++ = ',';
+    len = strlen(node->name);
+    memcpy(out, node->name, len);
+    out += len;
+    *out++ = ',';
+    const char* programme = programme_name(node->programme_code);
+    len = strlen(programme);
+    memcpy(out, programme, len);
+    out += len;
+    *out++ = ',';
+    out = format_marks(out, node->marks);
+    *out++ = ',';
+    const char* grade = grade_name(node->grade);
+    len = strlen(grade);
+    memcpy(out, grade, len);
+    out += len;
+    *out++ = '\n';
+    return out;
+}
+
+// Pad column that started at start with spaces up to width characters, like a "%-*s" conversion
+static char* pad_column(char* out, const char* start, int width) {
+    while (out - start < width) *out++ = ' ';
+    return out;
+}
+
+// Write record as a SHOW ALL table row, byte-identical to "%-7d  %-30s  %-50s  %-10.1f %-10s\n", returns end of written text
+char* format_table_row(char* out, const STUDENT_NODE* node) {
+    char* start = out;
+    size_t len;
+    out = pad_column(format_int(out, node->id), start, 7);
+    *out++ = ' ';
+    *out++ = ' ';
+    start = out;
+    len = strlen(node->name);
+    memcpy(out, node->name, len);
+    out = pad_column(out + len, start, MAX_NAME_LEN);
+    *out++ = ' ';
+    *out++ = ' ';
+    start = out;
+    const char* programme = programme_name(node->programme_code);
+    len = strlen(programme);
+    memcpy(out, programme, len);
+    out = pad_column(out + len, start, MAX_PROGRAMME_LEN);
+    *out++ = ' ';
+    *out++ = ' ';
+    start = out;
+    out = pad_column(format_marks(out, node->marks), start, 10);
+    *out++ = ' ';
+    start = out;
+    const char* grade = grade_name(node->grade);
+    len = strlen(grade);
+    memcpy(out, grade, len);
+    out = pad_column(out + len, start, 10);
+    *out++ = '\n';
+    return out;
+}
+
+// Write up to count table rows starting at node from, collected into a large buffer so output needs few writes
+// Returns node after the last row written (NULL at end of list), or from itself if the buffer cannot be allocated
+STUDENT_NODE* write_table_rows(FILE* file, STUDENT_NODE* from, int count) {
+    char* buffer = malloc(SAVE_BUFFER_SIZE);
+    if (!buffer) return from;
+    fflush(file); // Rows must follow any text already printed to file
+    char* out = buffer;
+    STUDENT_NODE* current = from;
+    while (current && count-- > 0) {
+        out = format_table_row(out, current);
+        if ((size_t)(buffer + SAVE_BUFFER_SIZE - out) < TABLE_ROW_MAX) {
+            fwrite(buffer, 1, out - buffer, file); // Larger than the stdio buffer, so written straight through
+            out = buffer;
+        }
+        current = current->next;
+    }
+    if (out > buffer) fwrite(buffer, 1, out - buffer, file);
+    fflush(file);
+    free(buffer);
+    return current;
+}
+
+// Write whole SHOW ALL table with header and record count to file, returns 0 on allocation failure
+// Rows come from a snapshot of the record store, so concurrent writers neither block nor tear the listing
+int write_record_table(FILE* file) {
+    STORE_READER reader;
+    if (!store_read_begin(&reader)) return 0;
+    int* slots = malloc((reader.count + 1) * sizeof(int));
+    char* buffer = malloc(SAVE_BUFFER_SIZE);
+    if (!slots || !buffer) {
+        free(slots);
+        free(buffer);
+        store_read_end(&reader);
+        return 0;
+    }
+    int count = store_snapshot_slots(&reader, slots);
+    fprintf(file, "\n%-7s  %-30s  %-50s  %-10s %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+    fprintf(file, "===============================================================================================================\n");
+    fflush(file);
+    char* out = buffer;
+    for (int i = 0; i < count; i++) {
+        STUDENT_NODE copy;
+        if (!store_read_node(&reader, table_node(slots[i]), &copy)) continue;
+        out = format_table_row(out, &copy);
+        if ((size_t)(buffer + SAVE_BUFFER_SIZE - out) < TABLE_ROW_MAX) {
+            fwrite(buffer, 1, out - buffer, file);
+            out = buffer;
+        }
+    }
+    if (out > buffer) fwrite(buffer, 1, out - buffer, file);
+    free(buffer);
+    free(slots);
+    store_read_end(&reader);
+    fprintf(file, "===============================================================================================================\n");
+    fprintf(file, "CMS <SHOW ALL>: Found %d records in \"%s\" database!\n", count, DB_NAME);
+    return 1;
+}
+
+// Write whole table in the sorted order of column with header and record count to file, returns 0 on allocation failure
+int write_sorted_table(FILE* file, SORT_COLUMN column, int is_descending) {
+    SORTED_ORDER* order = &sorted_orders[column];
+    if (!order->is_built && !sorted_order_build(column)) return 0;
+    char* buffer = malloc(SAVE_BUFFER_SIZE);
+    STUDENT_NODE** nodes = malloc((order->count ? order->count : 1) * sizeof(STUDENT_NODE*));
+    if (!buffer || !nodes) {
+        free(buffer);
+        free(nodes);
+        return 0;
+    }
+    sorted_order_flatten(order, nodes);
+    fprintf(file, "\n%-7s  %-30s  %-50s  %-10s %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+    fprintf(file, "===============================================================================================================\n");
+    fflush(file);
+    char* out = buffer;
+    int run_first = 0, run_last = -1; // Run of equal keys being written when descending
+    for (int i = 0; i < order->count; i++) {
+        int pos = i;
+        if (is_descending) { // Walk runs of equal keys from the end, each run still in insertion order
+            if (run_first > run_last) {
+                run_last = order->count - 1 - i;
+                run_first = run_last;
+                while (run_first > 0 && compare_sort_keys(column, nodes[run_first - 1], nodes[run_last]) == 0) {
+                    run_first--;
+                }
+            }
+            pos = run_first++;
+        }
+        out = format_table_row(out, nodes[pos]);
+        if ((size_t)(buffer + SAVE_BUFFER_SIZE - out) < TABLE_ROW_MAX) {
+            fwrite(buffer, 1, out - buffer, file);
+            out = buffer;
+        }
+    }
+    if (out > buffer) fwrite(buffer, 1, out - buffer, file);
+    free(buffer);
+    free(nodes);
+    fprintf(file, "===============================================================================================================\n");
+    fprintf(file, "CMS <SHOW SORTED>: Found %d records in \"%s\" database sorted by %s (%s)!\n",
+        order->count, DB_NAME, SORT_COLUMN_NAMES[column], is_descending ? "descending" : "ascending");
+    return 1;
+}
+
+// Flush file to disk and close it, returns 0 if any step failed
+int sync_and_close(FILE* file_ptr) {
+    int is_ok = fflush(file_ptr) == 0;
+#ifdef _WIN32
+    if (is_ok && _commit(_fileno(file_ptr)) != 0) is_ok = 0;
+#else
+    if (is_ok && fsync(fileno(file_ptr)) != 0) is_ok = 0;
+#endif
+    if (fclose(file_ptr) != 0) is_ok = 0;
+    return is_ok;
+}
+
+void display_press_enter() {
+    printf(">> P14_8: Press [Enter] to continue..");
+    while (getchar() != '\n'); // Wait for user to press Enter
+    printf("\n");
+}
+
+void clean_fgets(char* input) {
+    // Check for input overflow before trimming as trimming would affect input[len - 1]
+    int len = strlen(input);
+    int has_overflow = len > 0 && input[len - 1] != '\n';
+
+    // Trim any leading and trailing white spaces
+    char* start = input; // Initialize pointer to start of input
+    while (isspace((unsigned char)*start)) {
+        start++;  // Move start pointer forward passing any leading white space
+    }
+
+    // Handle case where input is only spaces
+    if (*start == '\0') {
+        input[0] = '\0';  // Empty the string
+        return;
+    }
+    char* end = start + strlen(start) - 1; // Initialize end pointer
     while (isspace((unsigned char)*end) && end > start) { // Remove trailing spaces
         *end = '\0';
         end--;
@@ -1213,25 +3258,47 @@ void run_cmd(char* cmd) {
         else if (strcmp(cmd, "3") == 0 || strcasecmp(cmd, "QUERY") == 0) query_record();
         else if (strcmp(cmd, "4") == 0 || strcasecmp(cmd, "UPDATE") == 0) update_record();
         else if (strcmp(cmd, "5") == 0 || strcasecmp(cmd, "DELETE") == 0) delete_record();
-        else if (strcmp(cmd, "6") == 0 || strcasecmp(cmd, "SAVE") == 0) save_db();
+        else if (strcmp(cmd, "6") == 0 || strcasecmp(cmd, "SAVE") == 0) save_db(stdout, stderr);
         else if (strcmp(cmd, "7") == 0 || strcasecmp(cmd, "CLOSE") == 0) close_db();
         else if (strcmp(cmd, "8") == 0 || strcasecmp(cmd, "EXIT") == 0) {
+            wal_close(); // Logged changes stay on disk and are recovered on next OPEN
             printf("\n=========================================\n");
             printf("   Exiting program! Have a great day!     \n");
             printf("=========================================\n");
             exit(0);
         }
+        else if (strcasecmp(cmd, "MEMORY") == 0) write_memory_stats(stdout);
+        else if (strcasecmp(cmd, "SAVE BINARY") == 0) save_snapshot(stdout, stderr);
+        else if (strcasecmp(cmd, "IMPORT") == 0) import_records();
+        else if (strcasecmp(cmd, "SHOW PAGES") == 0) show_record_pages();
+        else if (strcasecmp(cmd, "SHOW SORTED") == 0) show_sorted_records();
+        else if (strcasecmp(cmd, "STATS") == 0) show_stats();
+        else if (strcasecmp(cmd, "QUERY WHERE") == 0) query_where(0);
+        else if (strcasecmp(cmd, "EXPLAIN") == 0) query_where(1);
+        else if (strcasecmp(cmd, "CACHE STATS") == 0) {
+            write_cache_stats(stdout);
+            display_press_enter();
+        }
         else if (strcmp(cmd, "9") == 0 || strcasecmp(cmd, "HELP") == 0) {
             printf("\nCMS: (Available Commands)\n");
-            printf("  %-8s - %-50s\n", "SHOW ALL", "Display all student records");
-            printf("  %-8s - %-50s\n", "INSERT", "Add a new student record");
-            printf("  %-8s - %-50s\n", "QUERY", "Find student records by id, name, programme or grade");
-            printf("  %-8s - %-50s\n", "UPDATE", "Modify existing student record");
-            printf("  %-8s - %-50s\n", "DELETE", "Delete existing student record");
-            printf("  %-8s - %-50s\n", "SAVE", "Save changes made to student records");
-            printf("  %-8s - %-50s\n", "CLOSE", "Close the database file and return to main menu");
-            printf("  %-8s - %-50s\n", "EXIT", "Exit the program");
-            printf("  %-8s - %-50s\n", "HELP", "View list of available commands");
+            printf("  %-11s - %-50s\n", "SHOW ALL", "Display all student records");
+            printf("  %-11s - %-50s\n", "SHOW PAGES", "Display student records one page at a time");
+            printf("  %-11s - %-50s\n", "SHOW SORTED", "Display student records sorted by any column");
+            printf("  %-11s - %-50s\n", "INSERT", "Add a new student record");
+            printf("  %-11s - %-50s\n", "QUERY", "Find records by id, name, programme, grade, marks");
+            printf("  %-11s - %-50s\n", "QUERY WHERE", "Find records matching conditions joined by AND, OR, NOT");
+            printf("  %-11s - %-50s\n", "EXPLAIN", "Show how QUERY WHERE would find records for conditions");
+            printf("  %-11s - %-50s\n", "UPDATE", "Modify existing student record");
+            printf("  %-11s - %-50s\n", "DELETE", "Delete existing student record");
+            printf("  %-11s - %-50s\n", "SAVE", "Save changes made to student records");
+            printf("  %-11s - %-50s\n", "CLOSE", "Close the database file and return to main menu");
+            printf("  %-11s - %-50s\n", "STATS", "Display marks and grade summary of each programme");
+            printf("  %-11s - %-50s\n", "MEMORY", "Display record storage usage and fragmentation");
+            printf("  %-11s - %-50s\n", "CACHE STATS", "Display hits, misses and memory of the query cache");
+            printf("  %-11s - %-50s\n", "SAVE BINARY", "Export records to binary snapshot \"" SNAPSHOT_FILE_NAME "\"");
+            printf("  %-11s - %-50s\n", "IMPORT", "Add records from a CSV file of ID,Name,Programme,Marks");
+            printf("  %-11s - %-50s\n", "EXIT", "Exit the program");
+            printf("  %-11s - %-50s\n", "HELP", "View list of available commands");
             display_press_enter();
         }
         else {
@@ -1239,7 +3306,12 @@ void run_cmd(char* cmd) {
         }
     }
     else {
-        if (strcmp(cmd, "1") == 0 || strcasecmp(cmd, "OPEN") == 0) open_db();
+        if (strcmp(cmd, "1") == 0 || strcasecmp(cmd, "OPEN") == 0 || strcasecmp(cmd, "OPEN BINARY") == 0) {
+            store_write_begin(); // Loading is one transaction of the record store
+            if (strcasecmp(cmd, "OPEN BINARY") == 0) open_snapshot();
+            else open_db();
+            store_write_end();
+        }
         else if (strcmp(cmd, "2") == 0 || strcasecmp(cmd, "EXIT") == 0) {
             printf("\n=========================================\n");
             printf("   Exiting program! Have a great day!     \n");
@@ -1248,9 +3320,10 @@ void run_cmd(char* cmd) {
         }
         else if (strcmp(cmd, "3") == 0 || strcasecmp(cmd, "HELP") == 0) {
             printf("\nCMS: (Available Commands)\n");
-            printf("  %-8s - %-50s\n", "OPEN", "Open the database file");
-            printf("  %-8s - %-50s\n", "EXIT", "Exit the program");
-            printf("  %-8s - %-50s\n", "HELP", "View list of available commands");
+            printf("  %-11s - %-50s\n", "OPEN", "Open the database file");
+            printf("  %-11s - %-50s\n", "OPEN BINARY", "Import records from binary snapshot \"" SNAPSHOT_FILE_NAME "\"");
+            printf("  %-11s - %-50s\n", "EXIT", "Exit the program");
+            printf("  %-11s - %-50s\n", "HELP", "View list of available commands");
             display_press_enter();
         }
         else {
@@ -1258,3 +3331,3000 @@ void run_cmd(char* cmd) {
         }
     }
 }
+
+// Open write-ahead log for appending, returns 0 if logging is unavailable
+int wal_open() {
+    wal.buffer = malloc(SAVE_BUFFER_SIZE);
+    if (!wal.buffer) return 0;
+    wal.file = fopen(WAL_FILE_NAME, "ab");
+    if (!wal.file) {
+        free(wal.buffer);
+        wal.buffer = NULL;
+        return 0;
+    }
+    wal.length = 0;
+    wal.pending = 0;
+    return 1;
+}
+
+// Append change to the log buffer as "<type>,<record line>", type is 'I'nsert, 'U'pdate or 'D'elete
+void wal_log(char type, const STUDENT_NODE* node) {
+    if (!wal.file) return;
+    size_t max_line = MAX_ID_LEN + MAX_NAME_LEN + MAX_PROGRAMME_LEN + 32; // Longest possible log record
+    if (SAVE_BUFFER_SIZE - wal.length < max_line) wal_commit(); // Make room in buffer
+    char* out = wal.buffer + wal.length;
+    *out++ = type;
+    *out++ = ',';
+    if (type == 'D') { // Deletes only need the student ID
+        out = format_int(out, node->id);
+        *out++ = '\n';
+    }
+    else {
+        out = format_record_line(out, node);
+    }
+    wal.length = out - wal.buffer;
+    wal.pending++;
+    wal.logged++;
+    if (wal.pending >= WAL_GROUP_COMMIT_RECORDS) wal_commit(); // Bound the number of changes at risk
+}
+
+// Write buffered log records and fsync once for the whole group
+void wal_commit() {
+    if (!wal.file || wal.pending == 0) return;
+    int is_ok = fwrite(wal.buffer, 1, wal.length, wal.file) == wal.length && fflush(wal.file) == 0;
+#ifdef _WIN32
+    if (is_ok && _commit(_fileno(wal.file)) != 0) is_ok = 0;
+#else
+    if (is_ok && fsync(fileno(wal.file)) != 0) is_ok = 0;
+#endif
+    if (!is_ok) {
+        fprintf(stderr, "\n[Error] Failed to write write-ahead log \"%s\"! SAVE to keep your changes!\n", WAL_FILE_NAME);
+    }
+    wal.length = 0;
+    wal.pending = 0;
+}
+
+// Apply logged changes on top of records loaded from database file, returns number of changes applied
+int wal_replay() {
+    size_t file_size;
+    char* file_data = map_file(WAL_FILE_NAME, &file_size);
+    if (!file_data) return 0; // No log, nothing to recover
+    const char* file_end = file_data + file_size;
+    const char* line = file_data;
+    int applied = 0;
+    while (line < file_end) {
+        const char* line_end = memchr(line, '\n', file_end - line);
+        if (!line_end) { // Record torn by a crash during commit, it was never acknowledged
+            fprintf(stderr, "\n[Error] Ignoring incomplete record at end of write-ahead log \"%s\"!\n", WAL_FILE_NAME);
+            break;
+        }
+        STUDENT_RECORD record;
+        char type = *line;
+        int is_valid = line_end - line > 2 && line[1] == ',';
+        if (is_valid && type == 'D') {
+            record.id = atoi(line + 2);
+            STUDENT_NODE* node = id_index_find(record.id);
+            if (node) remove_node(node); // Missing record means delete already reached database file
+        }
+        else if (is_valid && (type == 'I' || type == 'U') && parse_record_line(line + 2, line_end, &record)) {
+            STUDENT_NODE* node = id_index_find(record.id);
+            if (node) { // Update, or insert that already reached database file
+                if (!update_node(node, record.name, record.programme, record.marks)) {
+                    fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                    break;
+                }
+            }
+            else if ((node = table_alloc_node())) {
+                node->id = record.id;
+                if (!update_node(node, record.name, record.programme, record.marks) || !append_node(node)) {
+                    table_release_node(node);
+                    fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+                    break;
+                }
+            }
+        }
+        else {
+            fprintf(stderr, "\n[Error] Malformed record in write-ahead log \"%s\" skipped!\n", WAL_FILE_NAME);
+            line = line_end + 1;
+            continue;
+        }
+        applied++;
+        line = line_end + 1;
+    }
+    unmap_file(file_data, file_size);
+    wal.logged = applied;
+    return applied;
+}
+
+// Empty the log after its changes were compacted into database file, returns 0 if the log could not be reopened
+int wal_truncate() {
+    if (!wal.file) return 1;
+    wal.length = 0;
+    wal.pending = 0;
+    wal.logged = 0;
+    fclose(wal.file);
+    FILE* file_ptr = fopen(WAL_FILE_NAME, "wb"); // Truncate log
+    if (file_ptr) sync_and_close(file_ptr);
+    wal.file = fopen(WAL_FILE_NAME, "ab"); // Keep appending new changes
+    return wal.file != NULL;
+}
+
+// Flush and close the log when database is closed, removing it if it holds no changes
+void wal_close() {
+    if (wal.file) {
+        wal_commit();
+        fclose(wal.file);
+        if (wal.logged == 0) remove(WAL_FILE_NAME);
+    }
+    free(wal.buffer);
+    wal.file = NULL;
+    wal.buffer = NULL;
+    wal.length = 0;
+    wal.pending = 0;
+    wal.logged = 0;
+}
+
+// Hash string for dictionary lookups (FNV-1a)
+static unsigned int dict_hash(const char* string) {
+    unsigned int hash = 2166136261u;
+    while (*string) {
+        hash = (hash ^ (unsigned char)*string++) * 16777619u;
+    }
+    return hash;
+}
+
+// Return code of string in dictionary, adding it if not present, returns -1 on allocation failure
+int dict_intern(STRING_DICT* dict, const char* string) {
+    if ((dict->count + 1) * 2 > dict->slot_capacity) { // Keep hash table at most half full
+        int new_capacity = dict->slot_capacity ? dict->slot_capacity * 2 : 64;
+        int* new_slots = calloc(new_capacity, sizeof(int));
+        if (!new_slots) return -1;
+        for (int code = 0; code < dict->count; code++) {
+            unsigned int pos = dict_hash(dict->strings[code]) & (new_capacity - 1);
+            while (new_slots[pos]) pos = (pos + 1) & (new_capacity - 1);
+            new_slots[pos] = code + 1;
+        }
+        free(dict->slots);
+        dict->slots = new_slots;
+        dict->slot_capacity = new_capacity;
+    }
+    unsigned int mask = dict->slot_capacity - 1;
+    unsigned int pos = dict_hash(string) & mask;
+    while (dict->slots[pos]) {
+        if (strcmp(dict->strings[dict->slots[pos] - 1], string) == 0) return dict->slots[pos] - 1;
+        pos = (pos + 1) & mask;
+    }
+    if (dict->count == dict->capacity) {
+        int new_capacity = dict->capacity ? dict->capacity * 2 : 32;
+        char** new_strings = realloc(dict->strings, new_capacity * sizeof(char*));
+        if (!new_strings) return -1;
+        dict->strings = new_strings;
+        dict->capacity = new_capacity;
+    }
+    char* copy = malloc(strlen(string) + 1);
+    if (!copy) return -1;
+    strcpy(copy, string);
+    dict->strings[dict->count] = copy;
+    dict->slots[pos] = ++dict->count;
+    return dict->count - 1;
+}
+
+// Release dictionary memory
+void dict_free(STRING_DICT* dict) {
+    for (int i = 0; i < dict->count; i++) {
+        free(dict->strings[i]);
+    }
+    free(dict->strings);
+    free(dict->slots);
+    memset(dict, 0, sizeof(STRING_DICT));
+}
+
+// Store 16/32-bit values little-endian regardless of host byte order
+static unsigned char* put_u16(unsigned char* out, unsigned int value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    return out + 2;
+}
+
+static unsigned char* put_u32(unsigned char* out, unsigned int value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = (value >> 24) & 0xFF;
+    return out + 4;
+}
+
+static unsigned int get_u16(const unsigned char* in) {
+    return in[0] | (in[1] << 8);
+}
+
+static unsigned int get_u32(const unsigned char* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((unsigned int)in[3] << 24);
+}
+
+// Write records to binary snapshot file, printing the outcome to messages and failures to report
+// Returns 0 if the snapshot could not be written
+// Layout: header, programme dictionary of length-prefixed strings, then one record per student:
+// u32 ID, u16 marks in tenths, u16 programme code, u8 name length, name bytes (grade is recomputed on load)
+int save_snapshot(FILE* messages, FILE* report) {
+    // Programme codes of the in-memory dictionary are written as is
+    STRING_DICT* programmes = &programme_dict;
+    int record_count = node_count;
+    int is_failed = 0;
+    FILE* file_ptr = fopen(SNAPSHOT_TEMP_FILE_NAME, "wb");
+    unsigned char* buffer = file_ptr ? malloc(SAVE_BUFFER_SIZE) : NULL;
+    if (!buffer) {
+        fprintf(report, "\n[Error] Unable to create binary snapshot \"%s\"!\n", SNAPSHOT_FILE_NAME);
+        if (file_ptr) fclose(file_ptr);
+        remove(SNAPSHOT_TEMP_FILE_NAME);
+        return 0;
+    }
+
+    unsigned char* out = buffer;
+    memcpy(out, SNAPSHOT_MAGIC, 8);
+    out = put_u32(out + 8, SNAPSHOT_VERSION);
+    out = put_u32(out, record_count);
+    out = put_u32(out, programmes->count);
+    out = put_u32(out, 0); // Reserved
+    size_t max_entry = 1 + MAX_PROGRAMME_LEN + 9 + MAX_NAME_LEN; // Covers both a dictionary entry and a record
+    for (int i = 0; i < programmes->count && !is_failed; i++) {
+        if ((size_t)(buffer + SAVE_BUFFER_SIZE - out) < max_entry) { // Flush before another entry might not fit
+            is_failed = fwrite(buffer, 1, out - buffer, file_ptr) != (size_t)(out - buffer);
+            out = buffer;
+        }
+        size_t len = strlen(programmes->strings[i]);
+        *out++ = (unsigned char)len;
+        memcpy(out, programmes->strings[i], len);
+        out += len;
+    }
+    STUDENT_NODE* current = head;
+    for (int i = 0; i < record_count && !is_failed; i++, current = current->next) {
+        if ((size_t)(buffer + SAVE_BUFFER_SIZE - out) < max_entry) {
+            is_failed = fwrite(buffer, 1, out - buffer, file_ptr) != (size_t)(out - buffer);
+            out = buffer;
+        }
+        size_t len = strlen(current->name);
+        out = put_u32(out, current->id);
+        out = put_u16(out, marks_to_tenths(current->marks));
+        out = put_u16(out, current->programme_code);
+        *out++ = (unsigned char)len;
+        memcpy(out, current->name, len);
+        out += len;
+    }
+    if (!is_failed && out > buffer) {
+        is_failed = fwrite(buffer, 1, out - buffer, file_ptr) != (size_t)(out - buffer);
+    }
+    free(buffer);
+    if (!sync_and_close(file_ptr)) is_failed = 1;
+    if (is_failed || !replace_file(SNAPSHOT_TEMP_FILE_NAME, SNAPSHOT_FILE_NAME)) {
+        fprintf(report, "\n[Error] Failed to write binary snapshot \"%s\"!\n", SNAPSHOT_FILE_NAME);
+        remove(SNAPSHOT_TEMP_FILE_NAME);
+        return 0;
+    }
+    fprintf(messages, "\nCMS: Exported %d records to binary snapshot \"%s\"!\n", record_count, SNAPSHOT_FILE_NAME);
+    return 1;
+}
+
+// Load records from binary snapshot, decoding straight out of the mapped file into the record table
+// Records become unsaved changes so SAVE (or CLOSE) converts the snapshot back into the text database file
+void open_snapshot() {
+    size_t wal_size;
+    char* wal_data = map_file(WAL_FILE_NAME, &wal_size);
+    if (wal_data) {
+        unmap_file(wal_data, wal_size);
+        if (wal_size > 0) { // Logged changes belong to the text database file and would be mixed with the snapshot
+            fprintf(stderr, "\n[Error] Write-ahead log \"%s\" holds unsaved changes! OPEN and SAVE the database file first!\n", WAL_FILE_NAME);
+            return;
+        }
+    }
+    size_t file_size;
+    unsigned char* data = (unsigned char*)map_file(SNAPSHOT_FILE_NAME, &file_size);
+    if (!data) {
+        fprintf(stderr, "\n[Error] Binary snapshot \"%s\" not found! Use 'SAVE BINARY' to create one!\n", SNAPSHOT_FILE_NAME);
+        return;
+    }
+    const unsigned char* end = data + file_size;
+    if (file_size < SNAPSHOT_HEADER_SIZE || memcmp(data, SNAPSHOT_MAGIC, 8) != 0 || get_u32(data + 8) != SNAPSHOT_VERSION) {
+        fprintf(stderr, "\n[Error] \"%s\" is not a version %d binary snapshot!\n", SNAPSHOT_FILE_NAME, SNAPSHOT_VERSION);
+        unmap_file((char*)data, file_size);
+        return;
+    }
+    unsigned int record_count = get_u32(data + 12);
+    unsigned int programme_count = get_u32(data + 16);
+    // Programme codes are 16-bit and every record takes at least 9 bytes, larger counts cannot be genuine
+    if (programme_count > 0xFFFF || record_count > (file_size - SNAPSHOT_HEADER_SIZE) / 9) {
+        fprintf(stderr, "\n[Error] Binary snapshot \"%s\" is truncated or corrupt! Snapshot not opened!\n", SNAPSHOT_FILE_NAME);
+        unmap_file((char*)data, file_size);
+        return;
+    }
+    int* programmes = malloc((programme_count + 1) * sizeof(int)); // Snapshot programme code -> dictionary code
+    if (!programmes || !id_index_init(record_count)) {
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+        free(programmes);
+        unmap_file((char*)data, file_size);
+        return;
+    }
+    const unsigned char* in = data + SNAPSHOT_HEADER_SIZE;
+    int is_corrupt = 0;
+    int is_failed = 0; // Out of memory while loading
+    const char* invalid = NULL; // Text the database file could not hold, e.g. a comma in a name
+    for (unsigned int i = 0; i < programme_count && !is_corrupt && !invalid; i++) {
+        if (in >= end || in[0] > MAX_PROGRAMME_LEN || in + 1 + in[0] > end) is_corrupt = 1;
+        else {
+            char text[MAX_PROGRAMME_LEN + 1], programme[MAX_PROGRAMME_LEN + 1];
+            memcpy(text, in + 1, in[0]);
+            text[in[0]] = '\0';
+            invalid = check_programme(text, programme);
+            if (invalid) break;
+            programmes[i] = dict_intern(&programme_dict, programme);
+            if (programmes[i] < 0 || programmes[i] > 0xFFFF) is_corrupt = 1;
+            in += 1 + in[0];
+        }
+    }
+    for (unsigned int i = 0; i < record_count && !is_corrupt && !invalid; i++) {
+        if (end - in < 9 || in[8] > MAX_NAME_LEN || end - in < 9 + in[8] ||
+            get_u16(in + 6) >= programme_count || get_u16(in + 4) > 1000 ||
+            get_u32(in) == 0 || get_u32(in) > 9999999) { // Student ID must fit MAX_ID_LEN digits
+            is_corrupt = 1;
+            break;
+        }
+        char text[MAX_NAME_LEN + 1], name[MAX_NAME_LEN + 1];
+        memcpy(text, in + 9, in[8]);
+        text[in[8]] = '\0';
+        invalid = check_name(text, name);
+        if (invalid) break;
+        STUDENT_NODE* new_student_node = table_alloc_node();
+        if (!new_student_node) {
+            is_failed = 1;
+            break;
+        }
+        new_student_node->id = get_u32(in);
+        new_student_node->marks = (float)(get_u16(in + 4) / 10.0);
+        strcpy(new_student_node->name, name);
+        new_student_node->programme_code = programmes[get_u16(in + 6)];
+        new_student_node->grade = calculate_grade_code(new_student_node->marks);
+        in += 9 + in[8];
+        if (id_index_find(new_student_node->id)) { // Student ID must stay unique for the index
+            fprintf(stderr, "\n[Error] Duplicate student ID=\"%d\" in binary snapshot! Record skipped!\n", new_student_node->id);
+            table_release_node(new_student_node);
+            continue;
+        }
+        if (!append_node(new_student_node)) {
+            table_release_node(new_student_node);
+            is_failed = 1;
+            break;
+        }
+    }
+    // Only a complete snapshot is opened, a partial one saved over the database file would lose records
+    if (invalid || is_corrupt || is_failed) {
+        if (invalid) { // Saving such a record would write a database file that cannot be opened again
+            fprintf(stderr, "\n[Error] Binary snapshot \"%s\" holds an invalid record! %s Snapshot not opened!\n", SNAPSHOT_FILE_NAME, invalid);
+        }
+        else if (is_corrupt) {
+            fprintf(stderr, "\n[Error] Binary snapshot \"%s\" is truncated or corrupt! Snapshot not opened!\n", SNAPSHOT_FILE_NAME);
+        }
+        else {
+            fprintf(stderr, "\n[Error] Memory allocation failure! Snapshot not opened!\n");
+        }
+        reset_list();
+        free(programmes);
+        unmap_file((char*)data, file_size);
+        return;
+    }
+    name_index_build();
+    id_suffix_build();
+    sorted_orders_build();
+    free(programmes);
+    unmap_file((char*)data, file_size);
+    if (!wal_open()) {
+        fprintf(stderr, "\n[Error] Unable to open write-ahead log \"%s\"! Changes are only kept in memory until SAVE!\n", WAL_FILE_NAME);
+    }
+    is_file_open = 1;
+    is_changes_made = 1; // Database file does not hold the snapshot records yet
+    is_snapshot_unsaved = 1;
+    printf("\nCMS: Binary snapshot \"%s\" successfully opened! Found %d records! 'SAVE' to write them to \"%s\"!\n", SNAPSHOT_FILE_NAME, node_count, FILE_NAME);
+}
+
+// Collect distinct trigrams of lowercased name into keys, returns number of keys
+static int name_grams(const char* name, unsigned int* keys) {
+    int count = 0;
+    int length = strlen(name);
+    for (int i = 0; i + NAME_GRAM_LEN <= length; i++) {
+        unsigned int key = (unsigned int)tolower((unsigned char)name[i]) << 16 |
+                           (unsigned int)tolower((unsigned char)name[i + 1]) << 8 |
+                           (unsigned int)tolower((unsigned char)name[i + 2]);
+        int is_repeated = 0;
+        for (int j = 0; j < count && !is_repeated; j++) {
+            is_repeated = keys[j] == key;
+        }
+        if (!is_repeated) keys[count++] = key;
+    }
+    return count;
+}
+
+// Find posting list of trigram key, adding an empty one if is_create is set, returns NULL if absent or on allocation failure
+static NAME_GRAM* name_index_lookup(unsigned int key, int is_create) {
+    if (is_create && (name_index.count + 1) * 2 > name_index.capacity) { // Keep table at most half full
+        int new_capacity = name_index.capacity ? name_index.capacity * 2 : 1024;
+        NAME_GRAM* new_grams = calloc(new_capacity, sizeof(NAME_GRAM));
+        if (!new_grams) return NULL;
+        for (int i = 0; i < name_index.capacity; i++) { // Rehash existing posting lists
+            if (!name_index.grams[i].key) continue;
+            unsigned int pos = (name_index.grams[i].key * 2654435769u) & (new_capacity - 1);
+            while (new_grams[pos].key) pos = (pos + 1) & (new_capacity - 1);
+            new_grams[pos] = name_index.grams[i];
+        }
+        free(name_index.grams);
+        name_index.grams = new_grams;
+        name_index.capacity = new_capacity;
+    }
+    if (!name_index.capacity) return NULL;
+    unsigned int mask = name_index.capacity - 1;
+    unsigned int pos = (key * 2654435769u) & mask;
+    while (name_index.grams[pos].key) {
+        if (name_index.grams[pos].key == key) return &name_index.grams[pos];
+        pos = (pos + 1) & mask;
+    }
+    if (!is_create) return NULL;
+    name_index.grams[pos].key = key;
+    name_index.count++;
+    return &name_index.grams[pos];
+}
+
+// Add postings for every trigram of node name, returns 0 on allocation failure
+int name_index_add(STUDENT_NODE* node) {
+    unsigned int keys[MAX_NAME_LEN];
+    int key_count = name_grams(node->name, keys);
+    for (int i = 0; i < key_count; i++) {
+        NAME_GRAM* gram = name_index_lookup(keys[i], 1);
+        if (!gram) return 0;
+        if (gram->count == gram->capacity) {
+            int new_capacity = gram->capacity ? gram->capacity * 2 : 4;
+            int* new_slots = realloc(gram->slots, new_capacity * sizeof(int));
+            if (!new_slots) return 0;
+            gram->slots = new_slots;
+            gram->capacity = new_capacity;
+        }
+        gram->slots[gram->count++] = node->slot;
+        name_index.postings++;
+    }
+    return 1;
+}
+
+// Count postings of node name as stale before the node is deleted or renamed
+// Postings are not searched for and removed, candidates are verified against the current name anyway
+void name_index_forget(STUDENT_NODE* node) {
+    unsigned int keys[MAX_NAME_LEN];
+    name_index.stale += name_grams(node->name, keys);
+}
+
+// Index every node of the linked list, returns 0 and leaves index unbuilt on allocation failure
+int name_index_build() {
+    name_index_free();
+    name_index.is_built = 1;
+    for (STUDENT_NODE* current = head; current; current = current->next) {
+        if (!name_index_add(current)) {
+            name_index_free();
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Smallest posting list among trigrams of lowercase_query (at least NAME_GRAM_LEN characters)
+// Returns NULL with count 0 if some trigram is in no name, so nothing can match
+const int* name_index_candidates(const char* lowercase_query, int* count) {
+    unsigned int keys[MAX_NAME_LEN];
+    int key_count = name_grams(lowercase_query, keys);
+    NAME_GRAM* smallest = NULL;
+    for (int i = 0; i < key_count; i++) {
+        NAME_GRAM* gram = name_index_lookup(keys[i], 0);
+        if (!gram) { // Trigram appears in no name
+            *count = 0;
+            return NULL;
+        }
+        if (!smallest || gram->count < smallest->count) smallest = gram;
+    }
+    *count = smallest ? smallest->count : 0;
+    return smallest ? smallest->slots : NULL;
+}
+
+// Release posting lists and mark index unbuilt
+void name_index_free() {
+    for (int i = 0; i < name_index.capacity; i++) {
+        free(name_index.grams[i].slots);
+    }
+    free(name_index.grams);
+    memset(&name_index, 0, sizeof(NAME_INDEX));
+}
+
+// Add node to bucket, returns position of node in bucket or -1 on allocation failure
+int node_bucket_add(NODE_BUCKET* bucket, STUDENT_NODE* node) {
+    if (bucket->count == bucket->capacity) {
+        int new_capacity = bucket->capacity ? bucket->capacity * 2 : 16;
+        STUDENT_NODE** new_nodes = realloc(bucket->nodes, new_capacity * sizeof(STUDENT_NODE*));
+        if (!new_nodes) return -1;
+        bucket->nodes = new_nodes;
+        bucket->capacity = new_capacity;
+    }
+    bucket->nodes[bucket->count] = node;
+    return bucket->count++;
+}
+
+// Remove node at pos by moving the last node of the bucket into its place
+// Returns the moved node so the caller can update its position, or NULL if pos was the last entry
+STUDENT_NODE* node_bucket_remove(NODE_BUCKET* bucket, int pos) {
+    STUDENT_NODE* last = bucket->nodes[--bucket->count];
+    if (pos == bucket->count) return NULL;
+    bucket->nodes[pos] = last;
+    return last;
+}
+
+// Release every bucket of an array of buckets
+void node_buckets_free(NODE_BUCKET* buckets, int count) {
+    for (int i = 0; i < count; i++) {
+        free(buckets[i].nodes);
+        buckets[i].nodes = NULL;
+        buckets[i].count = 0;
+        buckets[i].capacity = 0;
+    }
+}
+
+// Marks index bucket for marks, values outside 0.0 to 100.0 (only possible from edited files) share the end buckets
+int marks_bucket(float marks) {
+    int tenths = marks_to_tenths(marks);
+    if (tenths < 0) return 0;
+    if (tenths >= MARKS_BUCKETS) return MARKS_BUCKETS - 1;
+    return tenths;
+}
+
+// Add node to the bucket of its grade and the marks index bucket of its marks, returns 0 on allocation failure
+int bucket_indexes_add(STUDENT_NODE* node) {
+    int grade_pos = node_bucket_add(&grade_buckets[node->grade], node);
+    if (grade_pos < 0) return 0;
+    int marks_pos = node_bucket_add(&marks_buckets[marks_bucket(node->marks)], node);
+    if (marks_pos < 0) {
+        node_bucket_remove(&grade_buckets[node->grade], grade_pos); // Node was the last entry, nothing moves
+        return 0;
+    }
+    node->grade_pos = grade_pos;
+    node->marks_pos = marks_pos;
+    return 1;
+}
+
+// Remove node from its grade bucket and marks index bucket
+void bucket_indexes_remove(STUDENT_NODE* node) {
+    STUDENT_NODE* moved = node_bucket_remove(&grade_buckets[node->grade], node->grade_pos);
+    if (moved) moved->grade_pos = node->grade_pos;
+    moved = node_bucket_remove(&marks_buckets[marks_bucket(node->marks)], node->marks_pos);
+    if (moved) moved->marks_pos = node->marks_pos;
+}
+
+// Collect up to limit nodes whose marks round to min_tenths..max_tenths into out, ordered by marks
+// Only buckets in range are visited and sorting stops at the bucket that fills limit, returns number of nodes collected
+// out must have room for node_count nodes as the last bucket visited is collected whole before limit is applied
+// Buckets keep no order (removal moves the last entry), so each visited bucket is sorted when collected:
+// top-K costs O(B log B) for the B >= K nodes of the visited buckets, at most one bucket more than K, not O(K)
+int marks_index_collect(int min_tenths, int max_tenths, int limit, int is_descending, STUDENT_NODE** out) {
+    int count = 0;
+    int first = min_tenths < 0 ? 0 : min_tenths;
+    int last = max_tenths >= MARKS_BUCKETS ? MARKS_BUCKETS - 1 : max_tenths;
+    for (int i = 0; i <= last - first && count < limit; i++) {
+        NODE_BUCKET* bucket = &marks_buckets[is_descending ? last - i : first + i];
+        int bucket_count = 0;
+        for (int j = 0; j < bucket->count; j++) { // End buckets may hold marks outside the range
+            int tenths = marks_to_tenths(bucket->nodes[j]->marks);
+            if (tenths >= min_tenths && tenths <= max_tenths) out[count + bucket_count++] = bucket->nodes[j];
+        }
+        // Order bucket by marks (end buckets mix values), ties keep list order
+        qsort(out + count, bucket_count, sizeof(STUDENT_NODE*), is_descending ? compare_node_marks_desc : compare_node_marks);
+        count += bucket_count;
+    }
+    return count < limit ? count : limit;
+}
+
+// Order nodes by ascending marks, then insertion order, for qsort
+int compare_node_marks(const void* a, const void* b) {
+    const STUDENT_NODE* node_a = *(STUDENT_NODE* const*)a;
+    const STUDENT_NODE* node_b = *(STUDENT_NODE* const*)b;
+    if (node_a->marks != node_b->marks) return node_a->marks < node_b->marks ? -1 : 1;
+    return compare_node_seq(a, b);
+}
+
+// Order nodes by descending marks, then insertion order, for qsort
+int compare_node_marks_desc(const void* a, const void* b) {
+    const STUDENT_NODE* node_a = *(STUDENT_NODE* const*)a;
+    const STUDENT_NODE* node_b = *(STUDENT_NODE* const*)b;
+    if (node_a->marks != node_b->marks) return node_a->marks > node_b->marks ? -1 : 1;
+    return compare_node_seq(a, b);
+}
+
+// Scalar kernel: ID digits containing digits (1 to MAX_ID_LEN decimal digits) anywhere, like strstr on the printed ID
+static void scan_id_digits_contain_scalar(const char* id_digits, int count, const char* digits, uint64_t* bitmap) {
+    int length = strlen(digits);
+    memset(bitmap, 0, (count + 63) / 64 * sizeof(uint64_t));
+    for (int i = 0; i < count; i++) {
+        const char* id = id_digits + (size_t)i * ID_DIGITS_LEN;
+        for (int offset = 0; offset + length <= MAX_ID_LEN; offset++) { // Null padding never equals a digit
+            if (memcmp(id + offset, digits, length) == 0) {
+                bitmap[i / 64] |= (uint64_t)1 << (i % 64);
+                break;
+            }
+        }
+    }
+}
+
+#ifdef SCAN_SIMD
+// SSE2 kernel: ID digits containing digits, 2 IDs per 16-byte compare
+// For each position the query can start at, one compare against the query placed at that position in both
+// 8-byte halves shows a match where every query byte of a half compared equal
+__attribute__((target("sse2")))
+static void scan_id_digits_contain_sse2(const char* id_digits, int count, const char* digits, uint64_t* bitmap) {
+    int length = strlen(digits);
+    int positions = MAX_ID_LEN - length + 1;
+    __m128i patterns[MAX_ID_LEN];
+    unsigned int masks[MAX_ID_LEN]; // Movemask bits of the query bytes in the low half
+    for (int offset = 0; offset < positions; offset++) {
+        char pattern[16] = { 0 };
+        memcpy(pattern + offset, digits, length);
+        memcpy(pattern + 8 + offset, digits, length);
+        patterns[offset] = _mm_loadu_si128((const __m128i*)pattern);
+        masks[offset] = ((1u << length) - 1) << offset;
+    }
+    memset(bitmap, 0, (count + 63) / 64 * sizeof(uint64_t));
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(id_digits + (size_t)i * ID_DIGITS_LEN));
+        unsigned int hits = 0;
+        for (int offset = 0; offset < positions; offset++) {
+            unsigned int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(v, patterns[offset]));
+            hits |= (equal & masks[offset]) == masks[offset];
+            hits |= ((equal >> 8 & masks[offset]) == masks[offset]) << 1;
+        }
+        bitmap[i / 64] |= (uint64_t)hits << (i % 64);
+    }
+    if (i < count) { // Odd row left over
+        uint64_t hit;
+        scan_id_digits_contain_scalar(id_digits + (size_t)i * ID_DIGITS_LEN, 1, digits, &hit);
+        bitmap[i / 64] |= hit << (i % 64);
+    }
+}
+
+// AVX2 kernel: ID digits containing digits, 4 IDs per 32-byte compare (same scheme as the SSE2 kernel)
+__attribute__((target("avx2")))
+static void scan_id_digits_contain_avx2(const char* id_digits, int count, const char* digits, uint64_t* bitmap) {
+    int length = strlen(digits);
+    int positions = MAX_ID_LEN - length + 1;
+    __m256i patterns[MAX_ID_LEN];
+    uint32_t masks[MAX_ID_LEN];
+    for (int offset = 0; offset < positions; offset++) {
+        char pattern[32] = { 0 };
+        for (int lane = 0; lane < 4; lane++) {
+            memcpy(pattern + lane * 8 + offset, digits, length);
+        }
+        patterns[offset] = _mm256_loadu_si256((const __m256i*)pattern);
+        masks[offset] = ((1u << length) - 1) << offset;
+    }
+    memset(bitmap, 0, (count + 63) / 64 * sizeof(uint64_t));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(id_digits + (size_t)i * ID_DIGITS_LEN));
+        uint32_t hits = 0;
+        for (int offset = 0; offset < positions; offset++) {
+            uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, patterns[offset]));
+            for (int lane = 0; lane < 4; lane++) {
+                hits |= (uint32_t)((equal >> (lane * 8) & masks[offset]) == masks[offset]) << lane;
+            }
+        }
+        bitmap[i / 64] |= (uint64_t)hits << (i % 64);
+    }
+    for (; i < count; i++) {
+        uint64_t hit;
+        scan_id_digits_contain_scalar(id_digits + (size_t)i * ID_DIGITS_LEN, 1, digits, &hit);
+        bitmap[i / 64] |= hit << (i % 64);
+    }
+}
+#endif
+
+// Fill levels with every set of scan kernels this CPU supports, slowest first, returns number of sets
+int scan_kernel_levels(SCAN_KERNELS* levels) {
+    int count = 0;
+    levels[count++] = (SCAN_KERNELS){ "scalar", scan_id_digits_contain_scalar };
+#ifdef SCAN_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        levels[count++] = (SCAN_KERNELS){ "sse2", scan_id_digits_contain_sse2 };
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        levels[count++] = (SCAN_KERNELS){ "avx2", scan_id_digits_contain_avx2 };
+    }
+#endif
+    return count;
+}
+
+// Select the fastest scan kernels supported by this CPU
+void scan_kernels_init() {
+    SCAN_KERNELS levels[3];
+    int count = scan_kernel_levels(levels);
+    scan_kernels = levels[count - 1];
+}
+
+// Position of first set bit at or after from in bitmap of words 64-bit words, returns -1 if there is none
+int bitmap_next(const uint64_t* bitmap, int words, int from) {
+    int word = from / 64;
+    if (word >= words) return -1;
+    uint64_t bits = bitmap[word] & (~(uint64_t)0 << (from % 64));
+    while (!bits) {
+        if (++word == words) return -1;
+        bits = bitmap[word];
+    }
+    int bit = 0;
+#ifdef __GNUC__
+    bit = __builtin_ctzll(bits);
+#else
+    while (!(bits >> bit & 1)) bit++;
+#endif
+    return word * 64 + bit;
+}
+
+// Measure rows per second of every supported scan kernel over a synthetic ID digits column, checking all levels agree
+void run_scan_benchmark(int rows) {
+    char* id_digits = calloc(rows, ID_DIGITS_LEN);
+    int words = (rows + 63) / 64;
+    uint64_t* bitmap = malloc(words * sizeof(uint64_t));
+    uint64_t* expected = malloc(words * sizeof(uint64_t));
+    if (!id_digits || !bitmap || !expected) {
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+        free(id_digits);
+        free(bitmap);
+        free(expected);
+        return;
+    }
+    srand(14);
+    for (int i = 0; i < rows; i++) {
+        int id = 1000000 + (rand() % 3000) * 3000 + rand() % 3000; // RAND_MAX may be as small as 32767
+        format_int(id_digits + (size_t)i * ID_DIGITS_LEN, id);
+    }
+    SCAN_KERNELS levels[3];
+    int level_count = scan_kernel_levels(levels);
+    printf("\n============== SCAN KERNEL BENCHMARK ==============\n");
+    printf("%-18s %-7s %15s %8s\n", "Kernel", "Level", "Rows/second", "Matches");
+    for (int level = 0; level < level_count; level++) {
+        int repeats = 0;
+        clock_t start = clock();
+        clock_t elapsed;
+        do { // Repeat until timing is long enough to trust
+            levels[level].id_digits_contain(id_digits, rows, "42", bitmap);
+            repeats++;
+            elapsed = clock() - start;
+        } while (elapsed < CLOCKS_PER_SEC / 5);
+        int matches = 0;
+        for (int i = bitmap_next(bitmap, words, 0); i >= 0; i = bitmap_next(bitmap, words, i + 1)) {
+            matches++;
+        }
+        if (level == 0) memcpy(expected, bitmap, words * sizeof(uint64_t));
+        else if (memcmp(expected, bitmap, words * sizeof(uint64_t)) != 0) {
+            fprintf(stderr, "\n[Error] %s kernel \"id_digits_contain\" disagrees with scalar kernel!\n", levels[level].name);
+        }
+        printf("%-18s %-7s %15.0f %8d\n", "id_digits_contain", levels[level].name, (double)rows * repeats * CLOCKS_PER_SEC / elapsed, matches);
+    }
+    printf("===================================================\n");
+    printf("CMS: Queries use \"%s\" scan kernels on this CPU!\n", scan_kernels.name);
+    free(id_digits);
+    free(bitmap);
+    free(expected);
+}
+
+// Work of one ID index benchmark thread
+typedef struct id_bench_job {
+    STUDENT_NODE* nodes; // ID_BENCH_POOL nodes with IDs no other thread uses
+    unsigned int seed;
+    int present; // Nodes of the pool in the index when the thread finishes
+} ID_BENCH_JOB;
+
+// Benchmark thread: toggle random IDs of its pool in and out of the ID index
+static void* id_bench_worker(void* arg) {
+    ID_BENCH_JOB* job = arg;
+    unsigned int seed = job->seed;
+    for (int i = 0; i < ID_BENCH_OPS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        STUDENT_NODE* node = &job->nodes[(seed >> 8) % ID_BENCH_POOL];
+        int status = id_index_insert(node);
+        if (status == 1) job->present++;
+        else if (status == -1 && id_index_remove(node->id) == node) job->present--; // Present already, delete it instead
+    }
+    return NULL;
+}
+
+// Wall clock time in seconds, clock() would add up the CPU time of all threads
+static double wall_seconds() {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Measure mixed insert/delete throughput of the sharded ID index alone with 1, 2, 4 ... max_threads threads
+void run_id_index_benchmark(int max_threads) {
+    STUDENT_NODE* nodes = calloc((size_t)max_threads * ID_BENCH_POOL, sizeof(STUDENT_NODE));
+    pthread_t* threads = malloc(max_threads * sizeof(pthread_t));
+    ID_BENCH_JOB* jobs = malloc(max_threads * sizeof(ID_BENCH_JOB));
+    if (!nodes || !threads || !jobs) {
+        fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+        free(nodes);
+        free(threads);
+        free(jobs);
+        return;
+    }
+    for (int i = 0; i < max_threads * ID_BENCH_POOL; i++) {
+        nodes[i].id = 1000000 + i * 7; // Spread over every shard
+    }
+    printf("\n============ ID INDEX BENCHMARK ============\n");
+    printf("%-8s %15s %8s %9s\n", "Threads", "Ops/second", "Speedup", "Records");
+    double single_rate = 0;
+    for (int thread_count = 1; ; thread_count *= 2) {
+        if (thread_count > max_threads) thread_count = max_threads; // Always finish with max_threads
+        if (!id_index_init(thread_count * ID_BENCH_POOL)) {
+            fprintf(stderr, "\n[Error] Memory allocation failure!\n");
+            break;
+        }
+        int started = 0;
+        double start = wall_seconds();
+        for (int i = 0; i < thread_count; i++) {
+            jobs[i].nodes = nodes + (size_t)i * ID_BENCH_POOL;
+            jobs[i].seed = 14 + i;
+            jobs[i].present = 0;
+            if (pthread_create(&threads[i], NULL, id_bench_worker, &jobs[i]) != 0) break;
+            started++;
+        }
+        int present = 0;
+        for (int i = 0; i < started; i++) {
+            pthread_join(threads[i], NULL);
+            present += jobs[i].present;
+        }
+        double rate = (double)started * ID_BENCH_OPS / (wall_seconds() - start);
+        if (thread_count == 1) single_rate = rate;
+        printf("%-8d %15.0f %7.2fx %9d\n", started, rate, rate / single_rate, present);
+        if (present != id_index_count()) { // Every insert-if-absent and delete must have been applied exactly once
+            fprintf(stderr, "\n[Error] ID index holds %d records, threads inserted %d!\n", id_index_count(), present);
+        }
+        if (thread_count == max_threads) break;
+    }
+    printf("============================================\n");
+    id_index_free();
+    free(nodes);
+    free(threads);
+    free(jobs);
+}
+
+// Pack up to MAX_ID_LEN digits into 4 bits each (digit + 1, 0 past the end), most significant first
+// Comparing keys orders suffixes like strcmp, and all suffixes starting with a prefix form one key range
+static uint32_t id_suffix_key(const char* digits) {
+    uint32_t key = 0;
+    for (int i = 0; i < MAX_ID_LEN; i++) {
+        key <<= 4;
+        if (*digits) key |= *digits++ - '0' + 1;
+    }
+    return key;
+}
+
+// Sort entries by suffix key with two 14-bit radix passes (keys are 28 bits), returns 0 on allocation failure
+static int id_suffix_sort(uint64_t* entries, int count) {
+    uint64_t* buffer = malloc((size_t)count * sizeof(uint64_t));
+    int* offsets = malloc((1 << 14) * sizeof(int));
+    if (!buffer || !offsets) {
+        free(buffer);
+        free(offsets);
+        return 0;
+    }
+    uint64_t* from = entries;
+    uint64_t* to = buffer;
+    for (int shift = 32; shift < 60; shift += 14) {
+        memset(offsets, 0, (1 << 14) * sizeof(int));
+        for (int i = 0; i < count; i++) offsets[from[i] >> shift & 0x3FFF]++;
+        int total = 0;
+        for (int digit = 0; digit < 1 << 14; digit++) { // Counts -> start positions
+            int bucket_count = offsets[digit];
+            offsets[digit] = total;
+            total += bucket_count;
+        }
+        for (int i = 0; i < count; i++) to[offsets[from[i] >> shift & 0x3FFF]++] = from[i];
+        uint64_t* swap = from;
+        from = to;
+        to = swap;
+    }
+    // Even number of passes leaves the result back in entries
+    free(buffer);
+    free(offsets);
+    return 1;
+}
+
+// Index every suffix of every ID in the linked list, returns 0 and leaves index unbuilt on allocation failure
+int id_suffix_build() {
+    id_suffix_free();
+    int count = 0;
+    for (STUDENT_NODE* current = head; current; current = current->next) {
+        count += strlen(table_id_digits(current->slot));
+    }
+    id_suffix_index.entries = malloc(((size_t)count + 1) * sizeof(uint64_t));
+    id_suffix_index.is_indexed = calloc(record_table.used + 1, 1);
+    if (!id_suffix_index.entries || !id_suffix_index.is_indexed) {
+        id_suffix_free();
+        return 0;
+    }
+    for (STUDENT_NODE* current = head; current; current = current->next) {
+        const char* digits = table_id_digits(current->slot);
+        for (int offset = 0; digits[offset]; offset++) {
+            id_suffix_index.entries[id_suffix_index.count++] = (uint64_t)id_suffix_key(digits + offset) << 32 | (uint32_t)current->slot;
+        }
+        id_suffix_index.is_indexed[current->slot] = 1;
+    }
+    if (!id_suffix_sort(id_suffix_index.entries, id_suffix_index.count)) {
+        id_suffix_free();
+        return 0;
+    }
+    id_suffix_index.indexed_slots = record_table.used;
+    id_suffix_index.is_built = 1;
+    return 1;
+}
+
+// Queue appended node for the next rebuild, its ID is scanned until then
+void id_suffix_add(STUDENT_NODE* node) {
+    if (id_suffix_index.pending_count == id_suffix_index.pending_capacity) {
+        int new_capacity = id_suffix_index.pending_capacity ? id_suffix_index.pending_capacity * 2 : 64;
+        int* new_pending = realloc(id_suffix_index.pending, new_capacity * sizeof(int));
+        if (!new_pending) { // Fall back to scanning rather than miss the node
+            id_suffix_free();
+            return;
+        }
+        id_suffix_index.pending = new_pending;
+        id_suffix_index.pending_capacity = new_capacity;
+    }
+    id_suffix_index.pending[id_suffix_index.pending_count++] = node->slot;
+}
+
+// Mask out suffixes of node before it is deleted (its slot may be recycled for another ID)
+void id_suffix_remove(STUDENT_NODE* node) {
+    if (node->slot < id_suffix_index.indexed_slots && id_suffix_index.is_indexed[node->slot]) {
+        id_suffix_index.is_indexed[node->slot] = 0;
+        id_suffix_index.deleted += strlen(table_id_digits(node->slot));
+        return;
+    }
+    for (int i = 0; i < id_suffix_index.pending_count; i++) { // Node was appended after the build
+        if (id_suffix_index.pending[i] == node->slot) {
+            id_suffix_index.pending[i] = id_suffix_index.pending[--id_suffix_index.pending_count];
+            return;
+        }
+    }
+}
+
+// Bound entries whose key starts with digits to first_entry..end_entry, returns their count plus pending IDs
+// The count is an upper bound on matches (entries of deleted IDs remain), -1 if the index is unbuilt
+int id_suffix_range(const char* digits, int* first_entry, int* end_entry) {
+    if (!id_suffix_index.is_built) return -1;
+    // Fold pending IDs in once scanning them costs more than a rebuild, and drop mostly deleted entries
+    if ((id_suffix_index.pending_count > 1024 && id_suffix_index.pending_count > id_suffix_index.count / 16) ||
+        id_suffix_index.deleted > id_suffix_index.count / 2) {
+        if (!id_suffix_build()) return -1;
+    }
+    int length = strlen(digits);
+    uint32_t low = id_suffix_key(digits); // Prefix followed by end markers, the smallest key starting with digits
+    uint32_t high = low | ((1u << 4 * (MAX_ID_LEN - length)) - 1); // Largest key starting with digits
+    int first = 0, last = id_suffix_index.count; // Binary search for first entry with key >= low
+    while (first < last) {
+        int middle = first + (last - first) / 2;
+        if (id_suffix_index.entries[middle] >> 32 < low) first = middle + 1;
+        else last = middle;
+    }
+    int end = first; // Then for first entry with key > high
+    last = id_suffix_index.count;
+    while (end < last) {
+        int middle = end + (last - end) / 2;
+        if (id_suffix_index.entries[middle] >> 32 <= high) end = middle + 1;
+        else last = middle;
+    }
+    *first_entry = first;
+    *end_entry = end;
+    return end - first + id_suffix_index.pending_count;
+}
+
+// Find nodes whose ID contains digits, returns number of matches in list order with *matches allocated
+// Returns -1 if the index is unbuilt or memory runs out, so the caller scans instead
+int id_suffix_find(const char* digits, STUDENT_NODE*** matches) {
+    int first, end;
+    if (id_suffix_range(digits, &first, &end) < 0) return -1;
+    *matches = malloc(((size_t)(end - first) + id_suffix_index.pending_count + 1) * sizeof(STUDENT_NODE*));
+    if (!*matches) return -1;
+    int match_count = 0;
+    for (int i = first; i < end; i++) {
+        int slot = (int)(uint32_t)id_suffix_index.entries[i];
+        if (!id_suffix_index.is_indexed[slot]) continue; // Deleted since the build
+        // An ID holding digits more than once has one entry per occurrence, keep only the first occurrence
+        const char* id = table_id_digits(slot);
+        if (id_suffix_key(strstr(id, digits)) != (uint32_t)(id_suffix_index.entries[i] >> 32)) continue;
+        (*matches)[match_count++] = table_node(slot);
+    }
+    for (int i = 0; i < id_suffix_index.pending_count; i++) {
+        if (strstr(table_id_digits(id_suffix_index.pending[i]), digits)) {
+            (*matches)[match_count++] = table_node(id_suffix_index.pending[i]);
+        }
+    }
+    qsort(*matches, match_count, sizeof(STUDENT_NODE*), compare_node_seq); // Suffix order -> list order
+    return match_count;
+}
+
+// Release suffix array and mark index unbuilt
+void id_suffix_free() {
+    free(id_suffix_index.entries);
+    free(id_suffix_index.is_indexed);
+    free(id_suffix_index.pending);
+    memset(&id_suffix_index, 0, sizeof(ID_SUFFIX_INDEX));
+}
+
+// Split text at commas into at most max_fields fields with extra spaces removed, returns number of fields found
+static int split_batch_fields(char* text, char** fields, int max_fields) {
+    int count = 0;
+    while (1) {
+        char* comma = strchr(text, ',');
+        if (count < max_fields) {
+            fields[count] = text;
+        }
+        count++;
+        if (!comma) break;
+        *comma = '\0';
+        text = comma + 1;
+    }
+    for (int i = 0; i < count && i < max_fields; i++) {
+        remove_extra_spaces(fields[i]);
+    }
+    return count;
+}
+
+// Run one batch command without prompts, returns error message or NULL on success
+// Commands: OPEN, OPEN BINARY, INSERT id,name,programme,marks, UPDATE id,[name],[programme],[marks],
+// DELETE id, QUERY ID id, IMPORT file, SHOW ALL, SHOW SORTED ID|NAME|PROGRAMME|MARKS [DESC], STATS, SAVE, SAVE BINARY, MEMORY, CLOSE
+const char* run_batch_line(char* line, FILE* out) {
+    static char error[128]; // Messages naming a student ID
+    char* args = line + strcspn(line, " \t"); // Command word ends at first blank
+    if (*args) *args++ = '\0';
+    int is_binary = strcasecmp(args, "BINARY") == 0;
+
+    if (strcasecmp(line, "OPEN") == 0 && (is_binary || *args == '\0')) {
+        if (is_file_open) return "Database file is already open!";
+        store_write_begin();
+        if (is_binary) open_snapshot();
+        else open_db();
+        store_write_end();
+        return is_file_open ? NULL : "Database file could not be opened!";
+    }
+    if (!is_file_open) return "No database file open! 'OPEN' it first!";
+
+    if (strcasecmp(line, "INSERT") == 0 || strcasecmp(line, "UPDATE") == 0) {
+        int is_insert = strcasecmp(line, "INSERT") == 0;
+        char* fields[4];
+        if (split_batch_fields(args, fields, 4) != 4) return "Expected ID,Name,Programme,Marks!";
+        int id;
+        char name[MAX_NAME_LEN + 1];
+        char programme[MAX_PROGRAMME_LEN + 1];
+        float marks;
+        const char* check_error = check_id(fields[0], &id);
+        if (check_error) return check_error;
+        STUDENT_NODE* node = id_index_find(id);
+        if (is_insert && node) {
+            snprintf(error, sizeof(error), "Record with student ID=\"%d\" already exists!", id);
+            return error;
+        }
+        if (!is_insert && !node) {
+            snprintf(error, sizeof(error), "Record with student ID=\"%d\" not found!", id);
+            return error;
+        }
+        if (!is_insert && !*fields[1] && !*fields[2] && !*fields[3]) return "Nothing to update!";
+        // Fields left empty by UPDATE keep their current value
+        if (!is_insert && !*fields[1]) strcpy(name, node->name);
+        else if ((check_error = check_name(fields[1], name))) return check_error;
+        if (!is_insert && !*fields[2]) strcpy(programme, programme_name(node->programme_code));
+        else if ((check_error = check_programme(fields[2], programme))) return check_error;
+        if (!is_insert && !*fields[3]) marks = node->marks;
+        else if ((check_error = check_marks(fields[3], &marks))) return check_error;
+
+        store_write_begin();
+        if (is_insert && (node = table_alloc_node())) {
+            node->id = id;
+            if (!update_node(node, name, programme, marks) || !append_node(node)) {
+                table_release_node(node);
+                node = NULL;
+            }
+        }
+        else if (!is_insert && !update_node(node, name, programme, marks)) {
+            node = NULL;
+        }
+        if (node) wal_log(is_insert ? 'I' : 'U', node);
+        store_write_end();
+        if (!node) return "Memory allocation failure!";
+        is_changes_made = 1;
+        return NULL;
+    }
+    if (strcasecmp(line, "DELETE") == 0) {
+        int id;
+        remove_extra_spaces(args);
+        const char* check_error = check_id(args, &id);
+        if (check_error) return check_error;
+        STUDENT_NODE* node = id_index_find(id);
+        if (!node) {
+            snprintf(error, sizeof(error), "Record with student ID=\"%d\" not found!", id);
+            return error;
+        }
+        store_write_begin();
+        wal_log('D', node); // Log delete while node fields are still intact
+        remove_node(node);
+        store_write_end();
+        is_changes_made = 1;
+        return NULL;
+    }
+    if (strcasecmp(line, "QUERY") == 0 && strncasecmp(args, "ID ", 3) == 0) { // Exact student ID lookup
+        int id;
+        remove_extra_spaces(args + 3);
+        const char* check_error = check_id(args + 3, &id);
+        if (check_error) return check_error;
+        STUDENT_NODE* node = id_index_find(id);
+        if (!node) {
+            snprintf(error, sizeof(error), "Record with student ID=\"%d\" not found!", id);
+            return error;
+        }
+        char row[TABLE_ROW_MAX];
+        fprintf(out, "%.*s", (int)(format_table_row(row, node) - row), row);
+        return NULL;
+    }
+    if (strcasecmp(line, "QUERY") == 0 && strncasecmp(args, "WHERE ", 6) == 0) return write_query_results(out, args + 6);
+    if (strcasecmp(line, "EXPLAIN") == 0) return write_query_plan(out, args);
+    if (strcasecmp(line, "CACHE") == 0 && strcasecmp(args, "STATS") == 0) {
+        write_cache_stats(out);
+        return NULL;
+    }
+    if (strcasecmp(line, "IMPORT") == 0) {
+        int count, rejected;
+        STUDENT_RECORD* records = import_csv_read(args, &count, &rejected, out);
+        if (!records) return "CSV file could not be read!";
+        store_write_begin();
+        int imported = import_csv_append(records, count);
+        store_write_end();
+        free(records);
+        if (imported < count) return "Memory allocation failure!";
+        fprintf(out, "CMS <IMPORT>: %d records imported from \"%s\", %d lines rejected!\n", imported, args, rejected);
+        return rejected ? "CSV file has rejected lines!" : NULL;
+    }
+    if (strcasecmp(line, "SAVE") == 0 && (is_binary || *args == '\0')) {
+        if (is_binary) return save_snapshot(out, out) ? NULL : "Binary snapshot could not be saved!";
+        save_db(out, out);
+        return is_changes_made ? "Database file could not be saved!" : NULL;
+    }
+    if (strcasecmp(line, "SHOW") == 0 && strcasecmp(args, "ALL") == 0) { // Streams the table, e.g. to export it
+        return write_record_table(out) ? NULL : "Memory allocation failure!";
+    }
+    if (strcasecmp(line, "SHOW") == 0 && strncasecmp(args, "SORTED ", 7) == 0) {
+        static const char* const COLUMN_WORDS[SORT_COLUMN_COUNT] = { "ID", "NAME", "PROGRAMME", "MARKS" };
+        char* column_word = args + 7;
+        char* order_word = column_word + strcspn(column_word, " \t");
+        if (*order_word) *order_word++ = '\0';
+        remove_extra_spaces(order_word);
+        int is_descending = strcasecmp(order_word, "DESC") == 0;
+        if (!is_descending && *order_word && strcasecmp(order_word, "ASC") != 0) return "Sort order must be ASC or DESC!";
+        for (int column = 0; column < SORT_COLUMN_COUNT; column++) {
+            if (strcasecmp(column_word, COLUMN_WORDS[column]) == 0) {
+                return write_sorted_table(out, column, is_descending) ? NULL : "Memory allocation failure!";
+            }
+        }
+        return "Sort column must be ID, NAME, PROGRAMME or MARKS!";
+    }
+    if (strcasecmp(line, "STATS") == 0 && *args == '\0') {
+        if (!stats_table.is_built && !stats_table_build()) return "Memory allocation failure!";
+        return write_stats(out) ? NULL : "Memory allocation failure!";
+    }
+    if (strcasecmp(line, "MEMORY") == 0 && *args == '\0') {
+        write_memory_stats(out);
+        return NULL;
+    }
+    if (strcasecmp(line, "CLOSE") == 0 && *args == '\0') {
+        if (is_changes_made) save_db(out, out); // No one to confirm discarding changes, so save them
+        if (is_changes_made) return "Database file could not be saved! Close cancelled!";
+        close_db();
+        return NULL;
+    }
+    return "Unknown batch command!";
+}
+
+// Run every command of a batch file without menus or prompts, reporting failed lines to out
+// Blank lines and lines starting with '#' are skipped, returns number of failed commands
+int run_batch(FILE* in, FILE* out) {
+    char line[BATCH_LINE_LEN];
+    int line_number = 0;
+    int executed = 0;
+    int failed = 0;
+    while (fgets(line, sizeof(line), in)) {
+        line_number++;
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] != '\n' && !feof(in)) { // Line longer than buffer, skip the rest of it
+            int ch;
+            while ((ch = fgetc(in)) != '\n' && ch != EOF);
+            fprintf(out, "[Error] Line %d: Line exceeds %d characters!\n", line_number, BATCH_LINE_LEN - 2);
+            failed++;
+            continue;
+        }
+        while (len > 0 && isspace((unsigned char)line[len - 1])) line[--len] = '\0'; // Strip newline (and "\r")
+        char* command = line;
+        while (isspace((unsigned char)*command)) command++;
+        if (*command == '\0' || *command == '#') continue;
+        const char* error = run_batch_line(command, out); // Changes take the store write lock themselves
+        executed++;
+        if (error) {
+            fprintf(out, "[Error] Line %d: %s\n", line_number, error);
+            failed++;
+        }
+    }
+    wal_commit(); // Changes are durable in the log before reporting
+    wal_close(); // Logged changes not saved by the batch are recovered on next OPEN
+    fprintf(out, "\nCMS <BATCH>: %d commands executed from %d lines, %d failed!\n", executed, line_number, failed);
+    if (is_changes_made) {
+        fprintf(out, "CMS <BATCH>: Unsaved changes remain in write-ahead log \"%s\"! 'SAVE' to write them to \"%s\"!\n", WAL_FILE_NAME, FILE_NAME);
+    }
+    return failed;
+}
+
+// Check whether id is in the import ID set, adding it if not (set capacity is a power of 2 and never full)
+static int import_id_seen(int* set, unsigned int mask, int id) {
+    unsigned int pos = ((unsigned int)id * 2654435769u) & mask;
+    while (set[pos]) { // Student IDs are never 0, so 0 marks an empty slot
+        if (set[pos] == id) return 1;
+        pos = (pos + 1) & mask;
+    }
+    set[pos] = id;
+    return 0;
+}
+
+// Validate every line of a "[ID],[Name],[Programme],[Marks]" CSV file with the INSERT rules
+// Rejected lines are reported to report, IDs already in the database or earlier in the file are rejected
+// Returns valid records in file order (caller frees), or NULL if the file cannot be read
+STUDENT_RECORD* import_csv_read(const char* file_name, int* count, int* rejected, FILE* report) {
+    size_t size;
+    char* data = map_file(file_name, &size);
+    if (!data) return NULL;
+    const char* end = data + size;
+
+    // Every record line holds at least 8 bytes ("1234567," plus fields), which bounds the record count
+    int max_records = (int)(size / 8) + 1;
+    unsigned int set_capacity = 16;
+    while (set_capacity < (unsigned int)max_records * 2) set_capacity *= 2;
+    int* id_set = calloc(set_capacity, sizeof(int));
+    int capacity = 0;
+    STUDENT_RECORD* records = NULL;
+    *count = 0;
+    *rejected = 0;
+    if (!id_set) {
+        unmap_file(data, size);
+        return NULL;
+    }
+
+    char line[BATCH_LINE_LEN];
+    int line_number = 0;
+    int is_first_line = 1;
+    for (const char* p = data; p < end; ) {
+        const char* line_end = memchr(p, '\n', end - p);
+        if (!line_end) line_end = end; // Last line has no trailing newline
+        size_t len = line_end - p;
+        const char* line_start = p;
+        p = line_end + 1;
+        line_number++;
+        if (len >= sizeof(line)) {
+            fprintf(report, "[Error] Line %d: Line exceeds %d characters!\n", line_number, BATCH_LINE_LEN - 2);
+            (*rejected)++;
+            is_first_line = 0;
+            continue;
+        }
+        memcpy(line, line_start, len);
+        line[len] = '\0';
+        remove_extra_spaces(line); // Also drops the "\r" of CRLF line endings
+        if (line[0] == '\0') continue;
+        if (is_first_line && line[0] == '[') { // "[ID],[Name],[Programme],[Marks]" header
+            is_first_line = 0;
+            continue;
+        }
+        is_first_line = 0;
+
+        char* fields[4];
+        STUDENT_RECORD record;
+        const char* error = NULL;
+        if (split_batch_fields(line, fields, 4) != 4) error = "Expected ID,Name,Programme,Marks!";
+        else if (!(error = check_id(fields[0], &record.id)) &&
+                 !(error = check_name(fields[1], record.name)) &&
+                 !(error = check_programme(fields[2], record.programme)) &&
+                 !(error = check_marks(fields[3], &record.marks))) {
+            if (id_index_find(record.id)) error = "Student ID already exists in database!";
+            else if (import_id_seen(id_set, set_capacity - 1, record.id)) error = "Student ID repeats an earlier line!";
+        }
+        if (error) {
+            fprintf(report, "[Error] Line %d: %s\n", line_number, error);
+            (*rejected)++;
+            continue;
+        }
+        if (*count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 1024;
+            STUDENT_RECORD* new_records = realloc(records, new_capacity * sizeof(STUDENT_RECORD));
+            if (!new_records) {
+                free(records);
+                free(id_set);
+                unmap_file(data, size);
+                return NULL;
+            }
+            records = new_records;
+            capacity = new_capacity;
+        }
+        strcpy(record.grade, calculate_grade(record.marks));
+        records[(*count)++] = record;
+    }
+    free(id_set);
+    unmap_file(data, size);
+    if (!records) records = malloc(sizeof(STUDENT_RECORD)); // Valid empty result, distinct from a read failure
+    return records;
+}
+
+// Append validated records to the database in one pass, returns number appended (less than count on allocation failure)
+int import_csv_append(const STUDENT_RECORD* records, int count) {
+    for (int i = 0; i < count; i++) {
+        STUDENT_NODE* node = table_alloc_node();
+        if (!node) return i;
+        if (!fill_node(node, &records[i]) || !append_node(node)) {
+            table_release_node(node);
+            return i;
+        }
+        wal_log('I', node);
+        is_changes_made = 1;
+    }
+    return count;
+}
+
+// Compare the column keys of two nodes only, names and programmes ignore case, returns 0 for equal keys
+int compare_sort_keys(SORT_COLUMN column, const STUDENT_NODE* a, const STUDENT_NODE* b) {
+    switch (column) {
+    case SORT_BY_ID:
+        return (a->id > b->id) - (a->id < b->id);
+    case SORT_BY_NAME:
+        return strcasecmp(a->name, b->name);
+    case SORT_BY_PROGRAMME:
+        if (a->programme_code == b->programme_code) return 0;
+        return strcasecmp(programme_name(a->programme_code), programme_name(b->programme_code));
+    default:
+        return (a->marks > b->marks) - (a->marks < b->marks);
+    }
+}
+
+int compare_node_id(const void* a, const void* b) {
+    return compare_sort_keys(SORT_BY_ID, *(STUDENT_NODE* const*)a, *(STUDENT_NODE* const*)b);
+}
+
+int compare_node_name(const void* a, const void* b) {
+    int result = compare_sort_keys(SORT_BY_NAME, *(STUDENT_NODE* const*)a, *(STUDENT_NODE* const*)b);
+    return result ? result : compare_node_seq(a, b);
+}
+
+int compare_node_programme(const void* a, const void* b) {
+    int result = compare_sort_keys(SORT_BY_PROGRAMME, *(STUDENT_NODE* const*)a, *(STUDENT_NODE* const*)b);
+    return result ? result : compare_node_seq(a, b);
+}
+
+// Comparator giving the sorted order of each column, equal keys fall back to insertion order
+static int (* const SORT_COMPARATORS[SORT_COLUMN_COUNT])(const void* a, const void* b) = {
+    compare_node_id, compare_node_name, compare_node_programme, compare_node_marks
+};
+
+// Sort node pointers, using a parallel merge sort for large arrays when worker threads are enabled
+void sort_nodes(STUDENT_NODE** nodes, int count, int (*compare)(const void* a, const void* b)) {
+    if (worker_thread_count > 1 && count >= SORT_PARALLEL_MIN && sort_nodes_parallel(nodes, count, compare)) return;
+    qsort(nodes, count, sizeof(STUDENT_NODE*), compare);
+}
+
+// Sort job of a worker thread: sort its run in place, or merge its two sorted halves into the output array
+void* sort_worker(void* arg) {
+    SORT_JOB* job = arg;
+    if (!job->to) {
+        qsort(job->from + job->start, job->end - job->start, sizeof(STUDENT_NODE*), job->compare);
+        return NULL;
+    }
+    int left = job->start, right = job->mid, out = job->start;
+    while (left < job->mid && right < job->end) { // Take from left on ties so equal nodes keep their order
+        job->to[out++] = job->compare(&job->from[right], &job->from[left]) < 0 ? job->from[right++] : job->from[left++];
+    }
+    while (left < job->mid) job->to[out++] = job->from[left++];
+    while (right < job->end) job->to[out++] = job->from[right++];
+    return NULL;
+}
+
+// Sort runs of nodes on worker threads, then merge pairs of runs in parallel until one run is left
+// Runs whose thread cannot be started are handled on the calling thread, returns 0 if the merge buffer cannot be allocated
+int sort_nodes_parallel(STUDENT_NODE** nodes, int count, int (*compare)(const void* a, const void* b)) {
+    int run_count = worker_thread_count < SORT_MAX_THREADS ? worker_thread_count : SORT_MAX_THREADS;
+    STUDENT_NODE** temp = malloc(count * sizeof(STUDENT_NODE*));
+    if (!temp) return 0;
+    int bounds[SORT_MAX_THREADS + 1]; // Run i covers nodes[bounds[i], bounds[i + 1])
+    for (int i = 0; i <= run_count; i++) {
+        bounds[i] = (int)((long long)count * i / run_count);
+    }
+    SORT_JOB jobs[SORT_MAX_THREADS];
+    pthread_t threads[SORT_MAX_THREADS];
+
+    // Sort each run, run 0 on the calling thread
+    for (int i = 0; i < run_count; i++) {
+        jobs[i] = (SORT_JOB){ nodes, NULL, bounds[i], bounds[i], bounds[i + 1], compare };
+    }
+    int started = 1;
+    while (started < run_count && pthread_create(&threads[started], NULL, sort_worker, &jobs[started]) == 0) started++;
+    sort_worker(&jobs[0]);
+    for (int i = 1; i < started; i++) pthread_join(threads[i], NULL);
+    for (int i = started; i < run_count; i++) sort_worker(&jobs[i]); // Threads that could not start
+
+    // Merge neighbouring runs, alternating between nodes and temp as source
+    STUDENT_NODE** from = nodes;
+    STUDENT_NODE** to = temp;
+    while (run_count > 1) {
+        int job_count = 0;
+        for (int i = 0; i + 1 < run_count; i += 2) {
+            jobs[job_count++] = (SORT_JOB){ from, to, bounds[i], bounds[i + 1], bounds[i + 2], compare };
+        }
+        if (run_count % 2) { // Odd run out is copied through unchanged
+            int start = bounds[run_count - 1];
+            memcpy(to + start, from + start, (count - start) * sizeof(STUDENT_NODE*));
+        }
+        started = 1;
+        while (started < job_count && pthread_create(&threads[started], NULL, sort_worker, &jobs[started]) == 0) started++;
+        sort_worker(&jobs[0]);
+        for (int i = 1; i < started; i++) pthread_join(threads[i], NULL);
+        for (int i = started; i < job_count; i++) sort_worker(&jobs[i]);
+        int merged = 0;
+        for (int i = 0; i < run_count; i += 2) bounds[merged++] = bounds[i];
+        bounds[merged] = count;
+        run_count = merged;
+        STUDENT_NODE** swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != nodes) memcpy(nodes, from, count * sizeof(STUDENT_NODE*));
+    free(temp);
+    return 1;
+}
+
+// Check if node's name contains lowercase_keyword, ignoring case
+int name_contains(const STUDENT_NODE* node, const void* lowercase_keyword) {
+    char lowercase_student_name[MAX_NAME_LEN + 1];
+    int len = 0;
+    for (; node->name[len]; len++) {
+        lowercase_student_name[len] = tolower(node->name[len]);
+    }
+    lowercase_student_name[len] = '\0';
+    return strstr(lowercase_student_name, lowercase_keyword) != NULL;
+}
+
+// Check if node's programme code is flagged in is_code_matched (one flag per dictionary code)
+int programme_code_matched(const STUDENT_NODE* node, const void* is_code_matched) {
+    return ((const char*)is_code_matched)[node->programme_code];
+}
+
+// Scan job of a worker thread: collect nodes of its slot range whose snapshot copy satisfies the predicate
+void* scan_worker(void* arg) {
+    SCAN_JOB* job = arg;
+    int base = 0; // First slot of current segment
+    for (int segment = 0; base < job->end; segment++) { // Range ends at the used slots read when the scan started
+        int size = table_segment_size(segment);
+        int from = job->start > base ? job->start - base : 0;
+        int to = job->end - base < size ? job->end - base : size;
+        STUDENT_NODE* nodes = record_table.segments[segment].nodes;
+        for (int i = from; i < to; i++) {
+            STUDENT_NODE copy;
+            if (store_read_node(job->reader, &nodes[i], &copy) && job->predicate(&copy, job->context)) {
+                job->matches[job->match_count++] = &nodes[i];
+            }
+        }
+        base += size;
+    }
+    return NULL;
+}
+
+// Collect nodes of the snapshot of reader whose field values there satisfy predicate into matches
+// (room for reader->count nodes) in list order, returns number of matches. Reads the record table without locking,
+// so writers may go on meanwhile. Large tables are split into slot ranges evaluated on worker threads
+int scan_records(const STORE_READER* reader, SCAN_PREDICATE predicate, const void* context, STUDENT_NODE** matches) {
+    int used = __atomic_load_n(&record_table.used, __ATOMIC_ACQUIRE); // Covers every slot of the snapshot
+    int run_count = worker_thread_count < SCAN_MAX_THREADS ? worker_thread_count : SCAN_MAX_THREADS;
+    if (used < SCAN_PARALLEL_MIN) run_count = 1; // Thread start-up would cost more than the scan saves
+    STUDENT_NODE** found = malloc((used + 1) * sizeof(STUDENT_NODE*)); // Each job fills the part matching its slot range
+    if (!found) { // No memory for the split, scan straight into matches
+        SCAN_JOB job = { reader, predicate, context, 0, used, matches, 0 };
+        scan_worker(&job);
+        sort_nodes(matches, job.match_count, compare_node_seq);
+        return job.match_count;
+    }
+
+    SCAN_JOB jobs[SCAN_MAX_THREADS];
+    pthread_t threads[SCAN_MAX_THREADS];
+    for (int i = 0; i < run_count; i++) {
+        int start = (int)((long long)used * i / run_count);
+        int end = (int)((long long)used * (i + 1) / run_count);
+        jobs[i] = (SCAN_JOB){ reader, predicate, context, start, end, found + start, 0 };
+    }
+    int started = 1; // Range 0 is scanned on the calling thread
+    while (started < run_count && pthread_create(&threads[started], NULL, scan_worker, &jobs[started]) == 0) started++;
+    scan_worker(&jobs[0]);
+    for (int i = 1; i < started; i++) pthread_join(threads[i], NULL);
+    for (int i = started; i < run_count; i++) scan_worker(&jobs[i]); // Threads that could not start
+
+    int match_count = 0;
+    for (int i = 0; i < run_count; i++) {
+        memcpy(matches + match_count, jobs[i].matches, jobs[i].match_count * sizeof(STUDENT_NODE*));
+        match_count += jobs[i].match_count;
+    }
+    free(found);
+    // Recycled slots break slot order, so restore list order before display
+    sort_nodes(matches, match_count, compare_node_seq);
+    return match_count;
+}
+
+// Skip blanks in WHERE query text
+static void query_skip_spaces(const char** cursor) {
+    while (isspace((unsigned char)**cursor)) (*cursor)++;
+}
+
+// Consume keyword (any case) if it is the next word of WHERE query text, returns 0 and consumes nothing otherwise
+static int query_keyword(const char** cursor, const char* keyword) {
+    query_skip_spaces(cursor);
+    int len = strlen(keyword);
+    if (strncasecmp(*cursor, keyword, len) != 0) return 0;
+    if (isalnum((unsigned char)keyword[len - 1]) && isalnum((unsigned char)(*cursor)[len])) return 0; // Only part of a longer word
+    *cursor += len;
+    return 1;
+}
+
+// Take a free term of query, returns its index or -1 if the query has too many terms
+static int query_add_term(QUERY* query, char type, const char** error) {
+    if (query->count == QUERY_MAX_TERMS) {
+        *error = "Too many conditions!";
+        return -1;
+    }
+    QUERY_TERM* term = &query->terms[query->count];
+    memset(term, 0, sizeof(QUERY_TERM));
+    term->type = type;
+    return query->count++;
+}
+
+static int query_parse_or(QUERY* query, const char** cursor, const char** error);
+
+// Parse one condition "field operator value", with text values in double quotes when they hold blanks
+static int query_parse_test(QUERY* query, const char** cursor, const char** error) {
+    int index = query_add_term(query, 'T', error);
+    if (index < 0) return -1;
+    QUERY_TERM* term = &query->terms[index];
+    int field = 0;
+    while (field < QUERY_FIELD_COUNT && !query_keyword(cursor, QUERY_FIELD_NAMES[field])) field++;
+    if (field == QUERY_FIELD_COUNT) {
+        *error = "Expected a field (ID, NAME, PROGRAMME, MARKS or GRADE)!";
+        return -1;
+    }
+    int op = 0;
+    while (op < QUERY_OP_COUNT && !query_keyword(cursor, QUERY_OP_NAMES[op])) op++;
+    if (op == QUERY_OP_COUNT) {
+        *error = "Expected an operator (=, !=, <, <=, >, >= or CONTAINS)!";
+        return -1;
+    }
+    term->field = field;
+    term->op = op;
+
+    // Value is quoted text or runs to the next blank or parenthesis
+    char value[MAX_PROGRAMME_LEN + 1];
+    int len = 0;
+    query_skip_spaces(cursor);
+    if (**cursor == '"') {
+        const char* end = strchr(*cursor + 1, '"');
+        if (!end) {
+            *error = "Missing closing quote!";
+            return -1;
+        }
+        len = end - *cursor - 1;
+        if (len > MAX_PROGRAMME_LEN) {
+            *error = "Value is longer than 50 characters!";
+            return -1;
+        }
+        memcpy(value, *cursor + 1, len);
+        *cursor = end + 1;
+    }
+    else {
+        while ((*cursor)[len] && !isspace((unsigned char)(*cursor)[len]) && (*cursor)[len] != '(' && (*cursor)[len] != ')') {
+            if (len == MAX_PROGRAMME_LEN) {
+                *error = "Value is longer than 50 characters!";
+                return -1;
+            }
+            value[len] = (*cursor)[len];
+            len++;
+        }
+        *cursor += len;
+    }
+    value[len] = '\0';
+    if (len == 0) {
+        *error = "Expected a value after the operator!";
+        return -1;
+    }
+
+    if (field == QUERY_NAME || field == QUERY_PROGRAMME) {
+        if (op != QUERY_EQ && op != QUERY_NE && op != QUERY_CONTAINS) {
+            *error = "Only =, != and CONTAINS can be used with NAME and PROGRAMME!";
+            return -1;
+        }
+        for (int i = 0; i <= len; i++) {
+            term->text[i] = tolower(value[i]);
+        }
+    }
+    else if (field == QUERY_ID) {
+        if (len > MAX_ID_LEN || strspn(value, "0123456789") != (size_t)len) {
+            *error = "Student ID must be a number of at most 7 digits!";
+            return -1;
+        }
+        strcpy(term->text, value);
+        term->number = atoi(value);
+    }
+    else if (field == QUERY_MARKS) {
+        char* end;
+        term->number = (float)strtod(value, &end); // Compared as stored, so "MARKS >= 70.1" takes marks of 70.1
+        if (*end || !isfinite(term->number) || op == QUERY_CONTAINS) { // "nan" and "inf" parse but compare with nothing
+            *error = op == QUERY_CONTAINS ? "CONTAINS cannot be used with MARKS!" : "Marks must be a number!";
+            return -1;
+        }
+    }
+    else {
+        if (op == QUERY_CONTAINS) {
+            *error = "CONTAINS cannot be used with GRADE!";
+            return -1;
+        }
+        int grade = 0;
+        while (grade < GRADE_COUNT && strcasecmp(value, GRADE_NAMES[grade]) != 0) grade++;
+        if (grade == GRADE_COUNT) {
+            *error = "Invalid grade! Allowed grades are: A+, A, A-, B+, B, B-, C+, C, D+, D, F.";
+            return -1;
+        }
+        // A single letter names every grade of its letter, grade codes of one letter are adjacent
+        term->number = grade;
+        term->grade_first = grade;
+        term->grade_last = grade;
+        if (GRADE_NAMES[grade][1] == '\0') {
+            while (term->grade_first > 0 && GRADE_NAMES[term->grade_first - 1][0] == GRADE_NAMES[grade][0]) term->grade_first--;
+            while (term->grade_last < GRADE_COUNT - 1 && GRADE_NAMES[term->grade_last + 1][0] == GRADE_NAMES[grade][0]) term->grade_last++;
+        }
+    }
+    return index;
+}
+
+// Parse "NOT operand", "(conditions)" or a single condition
+static int query_parse_not(QUERY* query, const char** cursor, const char** error) {
+    if (query_keyword(cursor, "NOT")) {
+        int index = query_add_term(query, '!', error);
+        if (index < 0) return -1;
+        int operand = query_parse_not(query, cursor, error);
+        if (operand < 0) return -1;
+        query->terms[index].left = operand;
+        return index;
+    }
+    if (query_keyword(cursor, "(")) {
+        int index = query_parse_or(query, cursor, error);
+        if (index < 0) return -1;
+        if (!query_keyword(cursor, ")")) {
+            *error = "Missing closing parenthesis!";
+            return -1;
+        }
+        return index;
+    }
+    return query_parse_test(query, cursor, error);
+}
+
+// Parse operands joined by AND, which binds tighter than OR
+static int query_parse_and(QUERY* query, const char** cursor, const char** error) {
+    int left = query_parse_not(query, cursor, error);
+    while (left >= 0 && query_keyword(cursor, "AND")) {
+        int index = query_add_term(query, '&', error);
+        int right = index < 0 ? -1 : query_parse_not(query, cursor, error);
+        if (right < 0) return -1;
+        query->terms[index].left = left;
+        query->terms[index].right = right;
+        left = index;
+    }
+    return left;
+}
+
+// Parse operands joined by OR
+static int query_parse_or(QUERY* query, const char** cursor, const char** error) {
+    int left = query_parse_and(query, cursor, error);
+    while (left >= 0 && query_keyword(cursor, "OR")) {
+        int index = query_add_term(query, '|', error);
+        int right = index < 0 ? -1 : query_parse_and(query, cursor, error);
+        if (right < 0) return -1;
+        query->terms[index].left = left;
+        query->terms[index].right = right;
+        left = index;
+    }
+    return left;
+}
+
+// Parse WHERE query conditions and match programme conditions against the dictionary once
+// Returns NULL on success (free with query_free), or an error message
+const char* query_parse(const char* conditions, QUERY* query) {
+    const char* error = NULL;
+    const char* cursor = conditions;
+    query->count = 0;
+    query->root = query_parse_or(query, &cursor, &error);
+    query_skip_spaces(&cursor);
+    if (query->root >= 0 && *cursor) error = "Unexpected text after conditions!";
+    for (int i = 0; !error && i < query->count; i++) {
+        QUERY_TERM* term = &query->terms[i];
+        if (term->type != 'T' || term->field != QUERY_PROGRAMME) continue;
+        term->is_code_matched = calloc(programme_dict.count + 1, 1);
+        if (!term->is_code_matched) {
+            error = "Memory allocation failure!";
+            break;
+        }
+        for (int code = 0; code < programme_dict.count; code++) {
+            char lowercase_programme[MAX_PROGRAMME_LEN + 1];
+            const char* programme = programme_dict.strings[code];
+            int len = 0;
+            for (; programme[len] && len < MAX_PROGRAMME_LEN; len++) {
+                lowercase_programme[len] = tolower(programme[len]);
+            }
+            lowercase_programme[len] = '\0';
+            int is_found = term->op == QUERY_CONTAINS ? strstr(lowercase_programme, term->text) != NULL : strcmp(lowercase_programme, term->text) == 0;
+            term->is_code_matched[code] = term->op == QUERY_NE ? !is_found : is_found;
+        }
+    }
+    if (error) query_free(query);
+    return error;
+}
+
+// Release programme code flags of a parsed query
+void query_free(QUERY* query) {
+    for (int i = 0; i < query->count; i++) {
+        free(query->terms[i].is_code_matched);
+        query->terms[i].is_code_matched = NULL;
+    }
+    query->count = 0;
+}
+
+// Compare a and b with a relational operator of a WHERE query
+static int query_compare(double a, QUERY_OP op, double b) {
+    switch (op) {
+    case QUERY_EQ: return a == b;
+    case QUERY_NE: return a != b;
+    case QUERY_LE: return a <= b;
+    case QUERY_GE: return a >= b;
+    case QUERY_LT: return a < b;
+    default: return a > b;
+    }
+}
+
+// Evaluate one term of query for node
+static int query_term_matches(const QUERY* query, int index, const STUDENT_NODE* node) {
+    const QUERY_TERM* term = &query->terms[index];
+    switch (term->type) {
+    case '&': return query_term_matches(query, term->left, node) && query_term_matches(query, term->right, node);
+    case '|': return query_term_matches(query, term->left, node) || query_term_matches(query, term->right, node);
+    case '!': return !query_term_matches(query, term->left, node);
+    }
+    switch (term->field) {
+    case QUERY_ID:
+        if (term->op == QUERY_CONTAINS) return strstr(table_id_digits(node->slot), term->text) != NULL;
+        return query_compare(node->id, term->op, term->number);
+    case QUERY_NAME:
+        if (term->op == QUERY_CONTAINS) return name_contains(node, term->text);
+        return (strcasecmp(node->name, term->text) == 0) == (term->op == QUERY_EQ);
+    case QUERY_PROGRAMME:
+        return term->is_code_matched[node->programme_code];
+    case QUERY_MARKS:
+        return query_compare(node->marks, term->op, term->number);
+    default: // Better grades have lower codes, so "GRADE >= B" takes B- and every grade above it
+        switch (term->op) {
+        case QUERY_EQ: return node->grade >= term->grade_first && node->grade <= term->grade_last;
+        case QUERY_NE: return node->grade < term->grade_first || node->grade > term->grade_last;
+        case QUERY_GE: return node->grade <= term->grade_last;
+        case QUERY_GT: return node->grade < term->grade_first;
+        case QUERY_LE: return node->grade >= term->grade_first;
+        default: return node->grade > term->grade_last;
+        }
+    }
+}
+
+// Check if node satisfies every condition of a parsed query, usable as a scan_records predicate
+int query_matches(const STUDENT_NODE* node, const void* query) {
+    return query_term_matches(query, ((const QUERY*)query)->root, node);
+}
+
+// Grade codes selected by a grade condition as first..last, returns 0 for "!=", which selects two ranges
+static int query_grade_range(const QUERY_TERM* term, int* first, int* last) {
+    *first = 0;
+    *last = GRADE_COUNT - 1;
+    switch (term->op) {
+    case QUERY_EQ: *first = term->grade_first; *last = term->grade_last; return 1;
+    case QUERY_GE: *last = term->grade_last; return 1;
+    case QUERY_GT: *last = term->grade_first - 1; return 1;
+    case QUERY_LE: *first = term->grade_first; return 1;
+    case QUERY_LT: *first = term->grade_last + 1; return 1;
+    default: return 0;
+    }
+}
+
+// Marks index range in tenths that holds every record a marks condition can select, returns 0 for "!="
+static int query_marks_range(const QUERY_TERM* term, int* min_tenths, int* max_tenths) {
+    double marks = term->number < -1 ? -1 : term->number > 2 * MARKS_BUCKETS ? 2 * MARKS_BUCKETS : term->number; // Keeps tenths in int range
+    int tenths = marks_to_tenths((float)marks);
+    *min_tenths = INT_MIN;
+    *max_tenths = INT_MAX;
+    switch (term->op) {
+    case QUERY_EQ: *min_tenths = tenths; *max_tenths = tenths; return 1;
+    case QUERY_GE: case QUERY_GT: *min_tenths = tenths; return 1; // Rounding may pull in neighbours, the filter drops them
+    case QUERY_LE: case QUERY_LT: *max_tenths = tenths; return 1;
+    default: return 0;
+    }
+}
+
+// List access paths for query with estimated rows into plans (room for QUERY_MAX_TERMS + 1), returns the cheapest
+// Only conditions every match must satisfy (the root or operands of top-level ANDs) can choose candidates
+int query_plan(QUERY* query, QUERY_PLAN* plans, int* plan_count) {
+    int count = 0;
+    plans[count++] = (QUERY_PLAN){ ACCESS_FULL_SCAN, -1, node_count };
+    int stack[QUERY_MAX_TERMS];
+    int depth = 0;
+    stack[depth++] = query->root;
+    while (depth > 0) {
+        int index = stack[--depth];
+        QUERY_TERM* term = &query->terms[index];
+        if (term->type == '&') {
+            stack[depth++] = term->right;
+            stack[depth++] = term->left;
+            continue;
+        }
+        if (term->type != 'T') continue;
+        QUERY_PLAN plan = { ACCESS_COUNT, index, 0 };
+        if (term->field == QUERY_ID && term->op == QUERY_EQ) {
+            plan.access = ACCESS_ID_INDEX;
+            plan.estimate = id_index_find((int)term->number) != NULL;
+        }
+        else if (term->field == QUERY_ID && term->op == QUERY_CONTAINS) {
+            int first, end;
+            int estimate = id_suffix_range(term->text, &first, &end); // Two binary searches, counts stale entries too
+            if (estimate >= 0) {
+                plan.access = ACCESS_ID_SUFFIX;
+                plan.estimate = estimate;
+            }
+        }
+        else if (term->field == QUERY_NAME && term->op == QUERY_CONTAINS && name_index.is_built && strlen(term->text) >= NAME_GRAM_LEN) {
+            if (name_index.stale > name_index.postings / 2) name_index_build(); // As the name query does
+            if (name_index.is_built) {
+                plan.access = ACCESS_NAME_INDEX;
+                name_index_candidates(term->text, &plan.estimate);
+            }
+        }
+        else if (term->field == QUERY_GRADE) {
+            int first, last;
+            if (query_grade_range(term, &first, &last)) {
+                plan.access = ACCESS_GRADE_BUCKETS;
+                for (int grade = first; grade <= last; grade++) plan.estimate += grade_buckets[grade].count;
+            }
+        }
+        else if (term->field == QUERY_MARKS) {
+            int min_tenths, max_tenths;
+            if (query_marks_range(term, &min_tenths, &max_tenths)) {
+                plan.access = ACCESS_MARKS_INDEX;
+                int first = min_tenths < 0 ? 0 : min_tenths;
+                int last = max_tenths >= MARKS_BUCKETS ? MARKS_BUCKETS - 1 : max_tenths;
+                for (int bucket = first; bucket <= last; bucket++) plan.estimate += marks_buckets[bucket].count;
+            }
+        }
+        if (plan.access != ACCESS_COUNT) plans[count++] = plan;
+    }
+    *plan_count = count;
+    int best = 0;
+    for (int i = 1; i < count; i++) {
+        if (plans[i].estimate < plans[best].estimate) best = i;
+    }
+    return best;
+}
+
+// Write term of query as text to out, returns the end of the text written
+char* query_format(const QUERY* query, int index, char* out) {
+    const QUERY_TERM* term = &query->terms[index];
+    if (term->type == '!') {
+        out += sprintf(out, "NOT ");
+        int is_grouped = query->terms[term->left].type != 'T' && query->terms[term->left].type != '!';
+        if (is_grouped) *out++ = '(';
+        out = query_format(query, term->left, out);
+        if (is_grouped) *out++ = ')';
+        *out = '\0';
+        return out;
+    }
+    if (term->type == '&' || term->type == '|') {
+        for (int side = 0; side < 2; side++) {
+            int operand = side ? term->right : term->left;
+            int is_grouped = term->type == '&' && query->terms[operand].type == '|'; // OR binds looser than AND
+            if (side) out += sprintf(out, term->type == '&' ? " AND " : " OR ");
+            if (is_grouped) *out++ = '(';
+            out = query_format(query, operand, out);
+            if (is_grouped) *out++ = ')';
+        }
+        *out = '\0';
+        return out;
+    }
+    out += sprintf(out, "%s %s ", QUERY_FIELD_NAMES[term->field], QUERY_OP_NAMES[term->op]);
+    if (term->field == QUERY_NAME || term->field == QUERY_PROGRAMME) out += sprintf(out, "\"%s\"", term->text);
+    else if (term->field == QUERY_ID) out += sprintf(out, "%s", term->text);
+    else if (term->field == QUERY_MARKS) out += sprintf(out, "%g", term->number);
+    else out += sprintf(out, "%s", GRADE_NAMES[(int)term->number]);
+    return out;
+}
+
+// Collect records of the snapshot of reader matching query through the access path of plan into matches
+// (room for node_count, or the plan estimate if larger) in list order. Indexes only pick candidates, conditions are checked on snapshot copies
+// Returns number of matches, or -1 on allocation failure
+static int query_collect(const STORE_READER* reader, QUERY* query, const QUERY_PLAN* plan, STUDENT_NODE** matches) {
+    if (plan->access == ACCESS_FULL_SCAN) return scan_records(reader, query_matches, query, matches);
+    const QUERY_TERM* term = &query->terms[plan->term];
+    int count = 0;
+    if (plan->access == ACCESS_ID_INDEX) {
+        STUDENT_NODE* node = id_index_find((int)term->number);
+        if (node) matches[count++] = node;
+    }
+    else if (plan->access == ACCESS_ID_SUFFIX) {
+        STUDENT_NODE** found = NULL;
+        count = id_suffix_find(term->text, &found);
+        if (count < 0) return -1;
+        memcpy(matches, found, count * sizeof(STUDENT_NODE*));
+        free(found);
+    }
+    else if (plan->access == ACCESS_NAME_INDEX) {
+        int candidate_count;
+        const int* candidates = name_index_candidates(term->text, &candidate_count);
+        for (int i = 0; i < candidate_count; i++) {
+            matches[count++] = table_node(candidates[i]); // Stale postings of deleted nodes are not in the snapshot
+        }
+    }
+    else if (plan->access == ACCESS_GRADE_BUCKETS) {
+        int first, last;
+        query_grade_range(term, &first, &last);
+        for (int grade = first; grade <= last; grade++) {
+            memcpy(matches + count, grade_buckets[grade].nodes, grade_buckets[grade].count * sizeof(STUDENT_NODE*));
+            count += grade_buckets[grade].count;
+        }
+    }
+    else {
+        int min_tenths, max_tenths;
+        query_marks_range(term, &min_tenths, &max_tenths);
+        count = marks_index_collect(min_tenths, max_tenths, node_count, 0, matches);
+    }
+
+    // Check every condition on the candidates, then restore list order (postings may repeat after renames)
+    int match_count = 0;
+    for (int i = 0; i < count; i++) {
+        STUDENT_NODE copy;
+        if (store_read_node(reader, matches[i], &copy) && query_matches(&copy, query)) matches[match_count++] = matches[i];
+    }
+    sort_nodes(matches, match_count, compare_node_seq);
+    count = match_count;
+    match_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (match_count == 0 || matches[match_count - 1] != matches[i]) matches[match_count++] = matches[i];
+    }
+    return match_count;
+}
+
+// Write records matching WHERE query conditions to file in list order, returns NULL or an error message
+const char* write_query_results(FILE* file, const char* conditions) {
+    QUERY query;
+    const char* error = query_parse(conditions, &query);
+    if (error) return error;
+    QUERY_PLAN plans[QUERY_MAX_TERMS + 1];
+    int plan_count;
+    int best = query_plan(&query, plans, &plan_count);
+    STORE_READER reader;
+    if (!store_read_begin(&reader)) {
+        query_free(&query);
+        return "Too many snapshot readers!";
+    }
+    // Name postings repeat after renames, so trigram candidates (the plan estimate) can outnumber records
+    int room = plans[best].access == ACCESS_NAME_INDEX && plans[best].estimate > node_count ? plans[best].estimate : node_count;
+    STUDENT_NODE** matches = malloc((room + 1) * sizeof(STUDENT_NODE*));
+    int match_count = matches ? query_collect(&reader, &query, &plans[best], matches) : -1;
+    query_free(&query);
+    if (match_count <= 0) {
+        store_read_end(&reader);
+        free(matches);
+        if (match_count < 0) return "Memory allocation failure!";
+        fprintf(file, "\nCMS <QUERY WHERE>: No records found matching the conditions!\n");
+        return NULL;
+    }
+    fprintf(file, "\n%-7s  %-30s  %-50s  %-10s  %-10s\n", "[ID]", "[Name]", "[Programme]", "[Marks]", "[Grade]");
+    fprintf(file, "===============================================================================================================\n");
+    for (int i = 0; i < match_count; i++) {
+        STUDENT_NODE current;
+        store_read_node(&reader, matches[i], &current); // Field values the conditions were checked on
+        fprintf(file, "%-7d  %-30s  %-50s  %-10.1f  %-10s\n", current.id, current.name, programme_name(current.programme_code), current.marks, grade_name(current.grade));
+    }
+    store_read_end(&reader);
+    fprintf(file, "===============================================================================================================\n");
+    fprintf(file, "CMS <QUERY WHERE>: Found %d records matching the conditions!\n", match_count);
+    free(matches);
+    return NULL;
+}
+
+// Write the access paths considered for WHERE query conditions with estimated rows, marking the one chosen
+// Returns NULL or an error message
+const char* write_query_plan(FILE* file, const char* conditions) {
+    QUERY query;
+    const char* error = query_parse(conditions, &query);
+    if (error) return error;
+    QUERY_PLAN plans[QUERY_MAX_TERMS + 1];
+    int plan_count;
+    int best = query_plan(&query, plans, &plan_count);
+    char text[QUERY_MAX_TERMS * (MAX_PROGRAMME_LEN + 32)]; // Longest condition text times conditions
+    query_format(&query, query.root, text);
+    fprintf(file, "\nCMS <EXPLAIN>: WHERE %s\n", text);
+    fprintf(file, "  %-20s  %-60s  %-10s\n", "[Access Path]", "[Condition]", "[Est. Rows]");
+    fprintf(file, "===============================================================================================\n");
+    for (int i = 0; i < plan_count; i++) {
+        if (plans[i].term >= 0) query_format(&query, plans[i].term, text);
+        else if (worker_thread_count > 1 && record_table.used >= SCAN_PARALLEL_MIN) sprintf(text, "every record, on %d threads", worker_thread_count < SCAN_MAX_THREADS ? worker_thread_count : SCAN_MAX_THREADS);
+        else strcpy(text, "every record");
+        fprintf(file, "%c %-20s  %-60.60s  %-10d\n", i == best ? '*' : ' ', QUERY_ACCESS_NAMES[plans[i].access], text, plans[i].estimate);
+    }
+    fprintf(file, "===============================================================================================\n");
+    fprintf(file, "CMS <EXPLAIN>: Using %s, all conditions are checked on about %d candidate records!\n",
+        QUERY_ACCESS_NAMES[plans[best].access], plans[best].estimate);
+    query_free(&query);
+    return NULL;
+}
+
+// Release blocks of a sorted order, leaving it unbuilt
+static void sorted_order_clear(SORTED_ORDER* order) {
+    for (int i = 0; i < order->block_count; i++) free(order->blocks[i]);
+    free(order->blocks);
+    *order = (SORTED_ORDER){ NULL, 0, 0, 0, 0 };
+}
+
+// Make room for one more block at position pos of a sorted order, returns 0 on allocation failure
+static int sorted_order_insert_block(SORTED_ORDER* order, int pos) {
+    SORTED_BLOCK* block = malloc(sizeof(SORTED_BLOCK));
+    if (!block) return 0;
+    if (order->block_count == order->block_capacity) {
+        int new_capacity = order->block_capacity ? order->block_capacity * 2 : 16;
+        SORTED_BLOCK** new_blocks = realloc(order->blocks, new_capacity * sizeof(SORTED_BLOCK*));
+        if (!new_blocks) {
+            free(block);
+            return 0;
+        }
+        order->blocks = new_blocks;
+        order->block_capacity = new_capacity;
+    }
+    memmove(&order->blocks[pos + 1], &order->blocks[pos], (order->block_count - pos) * sizeof(SORTED_BLOCK*));
+    block->count = 0;
+    order->blocks[pos] = block;
+    order->block_count++;
+    return 1;
+}
+
+// Build sorted order of one column from the linked list, returns 0 on allocation failure
+// Blocks are filled to three quarters so inserts do not split them straight away
+int sorted_order_build(SORT_COLUMN column) {
+    SORTED_ORDER* order = &sorted_orders[column];
+    sorted_order_clear(order);
+    STUDENT_NODE** nodes = malloc((node_count ? node_count : 1) * sizeof(STUDENT_NODE*));
+    if (!nodes) return 0;
+    int count = 0;
+    for (STUDENT_NODE* current = head; current; current = current->next) {
+        nodes[count++] = current;
+    }
+    sort_nodes(nodes, count, SORT_COMPARATORS[column]);
+    int fill = SORTED_BLOCK_SIZE * 3 / 4;
+    for (int i = 0; i < count; i += fill) {
+        if (!sorted_order_insert_block(order, order->block_count)) {
+            sorted_order_clear(order);
+            free(nodes);
+            return 0;
+        }
+        SORTED_BLOCK* block = order->blocks[order->block_count - 1];
+        block->count = count - i < fill ? count - i : fill;
+        memcpy(block->nodes, nodes + i, block->count * sizeof(STUDENT_NODE*));
+    }
+    free(nodes);
+    order->count = count;
+    order->is_built = 1;
+    return 1;
+}
+
+// Build sorted orders of every column for the opened database
+void sorted_orders_build() {
+    for (int column = 0; column < SORT_COLUMN_COUNT; column++) {
+        sorted_order_build(column);
+    }
+}
+
+// Copy nodes of a built sorted order into nodes (room for order->count nodes) in key order
+void sorted_order_flatten(const SORTED_ORDER* order, STUDENT_NODE** nodes) {
+    for (int i = 0; i < order->block_count; i++) {
+        memcpy(nodes, order->blocks[i]->nodes, order->blocks[i]->count * sizeof(STUDENT_NODE*));
+        nodes += order->blocks[i]->count;
+    }
+}
+
+// Block of a sorted order that holds node or where it would be inserted: the first block whose last node is not before it
+// Returns block_count if node sorts after every block
+static int sorted_order_find_block(const SORTED_ORDER* order, STUDENT_NODE* node, int (*compare)(const void* a, const void* b)) {
+    int low = 0, high = order->block_count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        const SORTED_BLOCK* block = order->blocks[mid];
+        if (compare(&block->nodes[block->count - 1], &node) < 0) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Position of node in a block of a sorted order, or where it would be inserted
+static int sorted_block_search(const SORTED_BLOCK* block, STUDENT_NODE* node, int (*compare)(const void* a, const void* b)) {
+    int low = 0, high = block->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (compare(&block->nodes[mid], &node) < 0) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Insert linked node into every built sorted order, an order that cannot grow is dropped until next sorted listing
+void sorted_orders_add(STUDENT_NODE* node) {
+    for (int column = 0; column < SORT_COLUMN_COUNT; column++) {
+        SORTED_ORDER* order = &sorted_orders[column];
+        if (!order->is_built) continue;
+        int (*compare)(const void* a, const void* b) = SORT_COMPARATORS[column];
+        int block_pos = sorted_order_find_block(order, node, compare);
+        if (block_pos == order->block_count && block_pos > 0) block_pos--; // Goes at the end of the last block
+        if (order->block_count == 0 && !sorted_order_insert_block(order, 0)) {
+            sorted_order_clear(order);
+            continue;
+        }
+        SORTED_BLOCK* block = order->blocks[block_pos];
+        if (block->count == SORTED_BLOCK_SIZE) { // Split full block, moving its upper half into a new block after it
+            if (!sorted_order_insert_block(order, block_pos + 1)) {
+                sorted_order_clear(order);
+                continue;
+            }
+            SORTED_BLOCK* upper = order->blocks[block_pos + 1];
+            upper->count = SORTED_BLOCK_SIZE / 2;
+            block->count = SORTED_BLOCK_SIZE - upper->count;
+            memcpy(upper->nodes, block->nodes + block->count, upper->count * sizeof(STUDENT_NODE*));
+            if (compare(&block->nodes[block->count - 1], &node) < 0) block = upper;
+        }
+        int pos = sorted_block_search(block, node, compare);
+        memmove(&block->nodes[pos + 1], &block->nodes[pos], (block->count - pos) * sizeof(STUDENT_NODE*));
+        block->nodes[pos] = node;
+        block->count++;
+        order->count++;
+    }
+}
+
+// Remove node from every built sorted order, must be called while node still holds the keys it was inserted with
+void sorted_orders_remove(STUDENT_NODE* node) {
+    for (int column = 0; column < SORT_COLUMN_COUNT; column++) {
+        SORTED_ORDER* order = &sorted_orders[column];
+        if (!order->is_built) continue;
+        int block_pos = sorted_order_find_block(order, node, SORT_COMPARATORS[column]);
+        SORTED_BLOCK* block = block_pos < order->block_count ? order->blocks[block_pos] : NULL;
+        int pos = block ? sorted_block_search(block, node, SORT_COMPARATORS[column]) : 0;
+        if (!block || pos == block->count || block->nodes[pos] != node) { // Not found, order no longer matches the list
+            sorted_order_clear(order);
+            continue;
+        }
+        block->count--;
+        memmove(&block->nodes[pos], &block->nodes[pos + 1], (block->count - pos) * sizeof(STUDENT_NODE*));
+        order->count--;
+        if (block->count == 0) { // Drop empty block so every block has a last node to search by
+            free(block);
+            order->block_count--;
+            memmove(&order->blocks[block_pos], &order->blocks[block_pos + 1], (order->block_count - block_pos) * sizeof(SORTED_BLOCK*));
+        }
+    }
+}
+
+// Release memory of all sorted orders
+void sorted_orders_free() {
+    for (int column = 0; column < SORT_COLUMN_COUNT; column++) {
+        sorted_order_clear(&sorted_orders[column]);
+    }
+}
+
+// Add node to the aggregates of its programme, on allocation failure the table is dropped until next STATS
+void programme_stats_add(STUDENT_NODE* node) {
+    if (!stats_table.is_built) return;
+    int code = node->programme_code;
+    if (code >= stats_table.capacity) { // Programme dictionary has grown since the table was sized
+        int new_capacity = stats_table.capacity ? stats_table.capacity : 16;
+        while (new_capacity <= code) new_capacity *= 2;
+        PROGRAMME_STATS* new_programmes = realloc(stats_table.programmes, new_capacity * sizeof(PROGRAMME_STATS));
+        if (!new_programmes) {
+            stats_table_free();
+            stats_table.is_built = 0;
+            return;
+        }
+        memset(new_programmes + stats_table.capacity, 0, (new_capacity - stats_table.capacity) * sizeof(PROGRAMME_STATS));
+        stats_table.programmes = new_programmes;
+        stats_table.capacity = new_capacity;
+    }
+    PROGRAMME_STATS* stats = &stats_table.programmes[code];
+    if (!stats->marks_counts) { // First record of the programme
+        stats->marks_counts = calloc(MARKS_BUCKETS, sizeof(int));
+        if (!stats->marks_counts) {
+            stats_table_free();
+            stats_table.is_built = 0;
+            return;
+        }
+    }
+    stats->count++;
+    stats->sum += node->marks;
+    stats->sum_squares += (double)node->marks * node->marks;
+    stats->grade_counts[node->grade]++;
+    stats->marks_counts[marks_bucket(node->marks)]++;
+}
+
+// Take node out of the aggregates of its programme, must be called while node still holds the values it was added with
+void programme_stats_remove(STUDENT_NODE* node) {
+    if (!stats_table.is_built) return;
+    PROGRAMME_STATS* stats = &stats_table.programmes[node->programme_code];
+    stats->count--;
+    stats->sum -= node->marks;
+    stats->sum_squares -= (double)node->marks * node->marks;
+    stats->grade_counts[node->grade]--;
+    stats->marks_counts[marks_bucket(node->marks)]--;
+    if (stats->count == 0) { // Clear rounding left in the sums
+        stats->sum = 0;
+        stats->sum_squares = 0;
+    }
+}
+
+// Rebuild aggregates of every programme from the linked list, returns 0 on allocation failure
+int stats_table_build() {
+    stats_table_free();
+    for (STUDENT_NODE* current = head; current && stats_table.is_built; current = current->next) {
+        programme_stats_add(current);
+    }
+    return stats_table.is_built;
+}
+
+// Release aggregates, the table is empty and in step with an empty list again
+void stats_table_free() {
+    for (int i = 0; i < stats_table.capacity; i++) {
+        free(stats_table.programmes[i].marks_counts);
+    }
+    free(stats_table.programmes);
+    stats_table = (STATS_TABLE){ NULL, 0, 1 };
+}
+
+// Marks in tenths of the record at 0-based rank in ascending order of a marks histogram
+int histogram_rank(const int* marks_counts, int rank) {
+    int tenths = 0;
+    while (rank >= marks_counts[tenths]) {
+        rank -= marks_counts[tenths];
+        tenths++;
+    }
+    return tenths;
+}
+
+// Write one summary row for aggregates of name
+static void write_stats_row(FILE* file, const char* name, const PROGRAMME_STATS* stats) {
+    double mean = stats->sum / stats->count;
+    double variance = stats->sum_squares / stats->count - mean * mean;
+    int count = stats->count;
+    int min = histogram_rank(stats->marks_counts, 0);
+    int max = histogram_rank(stats->marks_counts, count - 1);
+    int p25 = histogram_rank(stats->marks_counts, (25 * (count - 1) + 50) / 100); // Nearest rank to the percentile
+    int p75 = histogram_rank(stats->marks_counts, (75 * (count - 1) + 50) / 100);
+    // Even counts take the mean of the two middle records
+    double median = (histogram_rank(stats->marks_counts, (count - 1) / 2) + histogram_rank(stats->marks_counts, count / 2)) / 20.0;
+    fprintf(file, "%-50s  %7d  %6.2f  %8.2f  %5.1f  %5.1f  %8.2f  %5.1f  %5.1f\n", name, count, mean,
+        variance > 0 ? sqrt(variance) : 0.0, min / 10.0, p25 / 10.0, median, p75 / 10.0, max / 10.0);
+}
+
+// Sort programme codes by programme name
+static int compare_programme_codes(const void* a, const void* b) {
+    return strcasecmp(programme_name(*(const int*)a), programme_name(*(const int*)b));
+}
+
+// Write marks summary and grade distribution of every programme with records, plus all programmes combined
+// Works from the aggregates only, so the cost grows with the number of programmes rather than records
+// Returns 0 on allocation failure, which the caller reports where its user sees it
+int write_stats(FILE* file) {
+    static const char* const LINE = "=====================================================================================================================";
+    int* codes = malloc((stats_table.capacity + 1) * sizeof(int));
+    int* all_marks_counts = calloc(MARKS_BUCKETS, sizeof(int));
+    if (!codes || !all_marks_counts) {
+        free(codes);
+        free(all_marks_counts);
+        return 0;
+    }
+    PROGRAMME_STATS all = { 0, 0, 0, { 0 }, all_marks_counts };
+    int code_count = 0;
+    for (int code = 0; code < stats_table.capacity; code++) {
+        const PROGRAMME_STATS* stats = &stats_table.programmes[code];
+        if (stats->count == 0) continue;
+        codes[code_count++] = code;
+        all.count += stats->count;
+        all.sum += stats->sum;
+        all.sum_squares += stats->sum_squares;
+        for (int grade = 0; grade < GRADE_COUNT; grade++) all.grade_counts[grade] += stats->grade_counts[grade];
+        for (int tenths = 0; tenths < MARKS_BUCKETS; tenths++) all.marks_counts[tenths] += stats->marks_counts[tenths];
+    }
+    qsort(codes, code_count, sizeof(int), compare_programme_codes);
+
+    fprintf(file, "\n%-50s  %7s  %6s  %8s  %5s  %5s  %8s  %5s  %5s\n",
+        "[Programme]", "[Count]", "[Mean]", "[StdDev]", "[Min]", "[P25]", "[Median]", "[P75]", "[Max]");
+    fprintf(file, "%s\n", LINE);
+    for (int i = 0; i < code_count; i++) {
+        write_stats_row(file, programme_name(codes[i]), &stats_table.programmes[codes[i]]);
+    }
+    fprintf(file, "%s\n", LINE);
+    if (all.count > 0) write_stats_row(file, "(All Programmes)", &all);
+
+    fprintf(file, "\n%-50s", "[Programme]");
+    for (int grade = 0; grade < GRADE_COUNT; grade++) fprintf(file, "  %4s", GRADE_NAMES[grade]);
+    fprintf(file, "\n%s\n", LINE);
+    for (int i = 0; i <= code_count; i++) {
+        const PROGRAMME_STATS* stats = i < code_count ? &stats_table.programmes[codes[i]] : &all;
+        if (i == code_count) fprintf(file, "%s\n", LINE);
+        fprintf(file, "%-50s", i < code_count ? programme_name(codes[i]) : "(All Programmes)");
+        for (int grade = 0; grade < GRADE_COUNT; grade++) fprintf(file, "  %4d", stats->grade_counts[grade]);
+        fprintf(file, "\n");
+    }
+    fprintf(file, "%s\n", LINE);
+    fprintf(file, "CMS <STATS>: %d records in %d programmes of \"%s\" database!\n", all.count, code_count, DB_NAME);
+    free(codes);
+    free(all_marks_counts);
+    return 1;
+}
+
+#ifdef SERVER_MODE
+// Connection of one client to the server, requests are read into in and responses queued in out
+typedef struct server_client {
+    int fd;
+    char in[BATCH_LINE_LEN]; // Start of a request line not yet terminated by a newline
+    size_t in_length;
+    int is_skipping; // Discarding the rest of an overlong request line
+    char* out; // Responses not yet sent
+    size_t out_length;
+    size_t out_sent;
+    int is_closing; // Close once out is sent (client sent QUIT)
+    int is_writable_wait; // Registered for EPOLLOUT because the socket buffer was full
+} SERVER_CLIENT;
+
+static volatile sig_atomic_t is_server_stopping = 0;
+
+// Signal handler asking the server event loop to stop
+static void server_stop(int signal_number) {
+    (void)signal_number;
+    is_server_stopping = 1;
+}
+
+// Append text to the responses queued for client, returns 0 on allocation failure or once more than
+// SERVER_MAX_OUTPUT bytes would wait for the client, which then is dropped without sending the rest
+static int server_queue(SERVER_CLIENT* client, const char* text, size_t length) {
+    if (client->out_sent > 0) { // Drop sent bytes so the buffer only holds what is still to be sent
+        memmove(client->out, client->out + client->out_sent, client->out_length - client->out_sent);
+        client->out_length -= client->out_sent;
+        client->out_sent = 0;
+    }
+    char* out = client->out_length + length <= SERVER_MAX_OUTPUT ? realloc(client->out, client->out_length + length) : NULL;
+    if (!out && client->out_length + length > 0) {
+        client->is_closing = 1; // Drop the client rather than desynchronise the protocol
+        client->out_sent = client->out_length; // Nothing more is sent, so it is closed without waiting for it to read
+        return 0;
+    }
+    client->out = out;
+    memcpy(client->out + client->out_length, text, length);
+    client->out_length += length;
+    return 1;
+}
+
+// Run one request line for client and queue its output followed by "OK" or "ERR <message>"
+// The server owns the database, so clients cannot OPEN or CLOSE it
+static void server_request(SERVER_CLIENT* client, char* line) {
+    char* command = line;
+    while (isspace((unsigned char)*command)) command++;
+    size_t len = strlen(command);
+    while (len > 0 && isspace((unsigned char)command[len - 1])) command[--len] = '\0';
+    if (*command == '\0') return; // Blank lines get no response
+
+    char* output = NULL;
+    size_t output_length = 0;
+    const char* error;
+    if (strcasecmp(command, "QUIT") == 0) {
+        client->is_closing = 1;
+        error = NULL;
+    }
+    else if (strncasecmp(command, "OPEN", 4) == 0 || strcasecmp(command, "CLOSE") == 0) {
+        error = "Database is opened and closed by the server!";
+    }
+    else {
+        FILE* out = open_memstream(&output, &output_length); // Collect command output for this client only
+        if (!out) {
+            error = "Memory allocation failure!";
+        }
+        else {
+            error = run_batch_line(command, out);
+            fclose(out);
+        }
+    }
+    char status[160];
+    int status_length = error ? snprintf(status, sizeof(status), "ERR %s\n", error) : snprintf(status, sizeof(status), "OK\n");
+    if (server_queue(client, output ? output : "", output_length)) server_queue(client, status, status_length);
+    free(output);
+}
+
+// Split newly read bytes of client into request lines and run each one
+static void server_read_requests(SERVER_CLIENT* client, const char* data, size_t length) {
+    for (size_t i = 0; i < length && !client->is_closing; i++) {
+        char ch = data[i];
+        if (ch == '\n') {
+            if (client->is_skipping) {
+                client->is_skipping = 0;
+                continue;
+            }
+            client->in[client->in_length] = '\0';
+            client->in_length = 0;
+            server_request(client, client->in);
+        }
+        else if (client->is_skipping) {
+            continue;
+        }
+        else if (client->in_length == sizeof(client->in) - 1) { // No room for the terminator
+            char status[64];
+            int status_length = snprintf(status, sizeof(status), "ERR Line exceeds %d characters!\n", BATCH_LINE_LEN - 2);
+            server_queue(client, status, status_length);
+            client->in_length = 0;
+            client->is_skipping = 1;
+        }
+        else {
+            client->in[client->in_length++] = ch;
+        }
+    }
+}
+
+// Send as much queued output as the socket accepts, returns 0 if the connection failed
+static int server_flush(int epoll_fd, SERVER_CLIENT* client) {
+    while (client->out_sent < client->out_length) {
+        ssize_t sent = send(client->fd, client->out + client->out_sent, client->out_length - client->out_sent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+            break;
+        }
+        client->out_sent += sent;
+    }
+    int is_pending = client->out_sent < client->out_length;
+    if (is_pending != client->is_writable_wait) { // Only wait for writability while output is queued
+        struct epoll_event event = { .events = EPOLLIN | (is_pending ? EPOLLOUT : 0), .data.ptr = client };
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+        client->is_writable_wait = is_pending;
+    }
+    return 1;
+}
+
+// Close client connection and release its buffers
+static void server_disconnect(int epoll_fd, SERVER_CLIENT* client, int* client_count) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    free(client->out);
+    free(client);
+    (*client_count)--;
+}
+
+// Load the database once and serve it to any number of clients on a Unix domain socket
+// Clients send one run_batch_line() command per line (INSERT, UPDATE, DELETE, QUERY ID, SHOW ALL, STATS, SAVE, ...)
+// and get the command output followed by "OK" or "ERR <message>". One thread runs every command in turn
+// from an epoll event loop, so commands never interleave, and changes of each wake-up share one WAL commit
+int run_server(const char* socket_path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "\n[Error] Socket path \"%s\" is too long!\n", socket_path);
+        return 1;
+    }
+    strcpy(address.sun_path, socket_path);
+    store_write_begin();
+    open_db();
+    store_write_end();
+    if (!is_file_open) return 1;
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(socket_path); // Remove socket left behind by a previous server
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "\n[Error] Unable to listen on socket \"%s\"!\n", socket_path);
+        if (listen_fd >= 0) close(listen_fd);
+        wal_close();
+        return 1;
+    }
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event listen_event = { .events = EPOLLIN, .data.ptr = NULL }; // NULL marks the listening socket
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &listen_event) < 0) {
+        fprintf(stderr, "\n[Error] Unable to start server event loop!\n");
+        close(listen_fd);
+        unlink(socket_path);
+        wal_close();
+        return 1;
+    }
+    struct sigaction stop_action = { .sa_handler = server_stop }; // No SA_RESTART, so epoll_wait returns on a signal
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+    printf("CMS <SERVER>: Serving \"%s\" on socket \"%s\"! Press Ctrl+C to stop!\n", FILE_NAME, socket_path);
+    fflush(stdout);
+
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    int client_count = 0;
+    while (!is_server_stopping) {
+        int event_count = epoll_wait(epoll_fd, events, SERVER_MAX_EVENTS, -1);
+        if (event_count < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "\n[Error] Server event loop failed!\n");
+            break;
+        }
+        // Run requests of every ready client first, then commit their changes once before replying
+        for (int i = 0; i < event_count; i++) {
+            SERVER_CLIENT* client = events[i].data.ptr;
+            if (!client) { // New connections on the listening socket
+                int fd;
+                while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+                    SERVER_CLIENT* new_client = calloc(1, sizeof(SERVER_CLIENT));
+                    struct epoll_event event = { .events = EPOLLIN, .data.ptr = new_client };
+                    if (!new_client || fcntl(fd, F_SETFL, O_NONBLOCK) < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+                        free(new_client);
+                        close(fd);
+                        continue;
+                    }
+                    new_client->fd = fd;
+                    client_count++;
+                }
+                continue;
+            }
+            if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) || client->is_closing) continue;
+            char data[4096];
+            ssize_t received = recv(client->fd, data, sizeof(data), 0);
+            if (received > 0) {
+                server_read_requests(client, data, received);
+            }
+            else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                client->is_closing = 1; // Client hung up, send what is left then close
+            }
+        }
+        wal_commit(); // Changes reach the log before any client is told they succeeded
+        for (int i = 0; i < event_count; i++) {
+            SERVER_CLIENT* client = events[i].data.ptr;
+            if (!client) continue;
+            if (!server_flush(epoll_fd, client) || (client->is_closing && client->out_sent == client->out_length)) {
+                server_disconnect(epoll_fd, client, &client_count);
+            }
+        }
+    }
+
+    printf("\nCMS <SERVER>: Stopping server with %d clients connected!\n", client_count);
+    close(epoll_fd); // Client sockets are closed by process exit
+    close(listen_fd);
+    unlink(socket_path);
+    wal_commit();
+    wal_close(); // Unsaved changes stay in the log and are recovered on next OPEN
+    if (is_changes_made) {
+        printf("CMS <SERVER>: Unsaved changes remain in write-ahead log \"%s\"! 'SAVE' to write them to \"%s\"!\n", WAL_FILE_NAME, FILE_NAME);
+    }
+    return 0;
+}
+#else
+// Server mode needs epoll, so it is only available on Linux
+int run_server(const char* socket_path) {
+    (void)socket_path;
+    fprintf(stderr, "\n[Error] Server mode is only supported on Linux!\n");
+    return 1;
+}
+#endif
+
+// Take the write lock of the record store, the calling thread's changes form one transaction until store_write_end
+// Every insert, update and delete holds it, the linked list, sorted orders and other indexes have no finer locks
+void store_write_begin() {
+    pthread_mutex_lock(&store.write_lock);
+}
+
+// Publish the transaction to snapshot readers, release what no snapshot needs any more and drop the write lock
+void store_write_end() {
+    uint64_t committed = (uint64_t)store.pending_version << 32 | (unsigned int)node_count;
+    __atomic_store_n(&store.committed, committed, __ATOMIC_SEQ_CST);
+    store.pending_version++;
+    store_collect_garbage();
+    pthread_mutex_unlock(&store.write_lock);
+}
+
+// Release deleted nodes and replaced field values older than every snapshot still held (caller holds write lock)
+void store_collect_garbage() {
+    unsigned int oldest = (unsigned int)(__atomic_load_n(&store.committed, __ATOMIC_SEQ_CST) >> 32);
+    for (int i = 0; i < STORE_MAX_READERS; i++) {
+        unsigned int version = __atomic_load_n(&store.readers[i], __ATOMIC_SEQ_CST);
+        if (version && version < oldest) oldest = version;
+    }
+    while (store.retired_nodes && store.retired_nodes->deleted_version <= oldest) {
+        STUDENT_NODE* node = store.retired_nodes;
+        store.retired_nodes = node->next;
+        table_release_node(node);
+    }
+    if (!store.retired_nodes) store.retired_nodes_tail = NULL;
+    while (store.retired_versions && store.retired_versions->end_version <= oldest) {
+        RECORD_VERSION* version = store.retired_versions;
+        store.retired_versions = version->next_retired;
+        free(version);
+    }
+    if (!store.retired_versions) store.retired_versions_tail = NULL;
+}
+
+// Free every replaced field value, only when no reader holds a snapshot
+void store_free_versions() {
+    while (store.retired_versions) {
+        RECORD_VERSION* version = store.retired_versions;
+        store.retired_versions = version->next_retired;
+        free(version);
+    }
+    store.retired_versions_tail = NULL;
+}
+
+// Mark unlinked node deleted by the current transaction, its slot is released by garbage collection (caller holds write lock)
+void table_retire_node(STUDENT_NODE* node) {
+    __atomic_store_n(&node->write_seq, node->write_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    node->deleted_version = store.pending_version;
+    // Writer-side column scans must not find the node any more, readers only look at the node itself
+    int id = node->id;
+    node->id = 0;
+    table_sync_columns(node);
+    node->id = id;
+    __atomic_store_n(&node->write_seq, node->write_seq + 1, __ATOMIC_RELEASE);
+    node->next = NULL;
+    if (store.retired_nodes_tail) store.retired_nodes_tail->next = node;
+    else store.retired_nodes = node;
+    store.retired_nodes_tail = node;
+}
+
+// Take a snapshot of the last published version of the record store, returns 0 if every reader entry is in use
+int store_read_begin(STORE_READER* reader) {
+    for (int i = 0; i < STORE_MAX_READERS; i++) {
+        uint64_t committed = __atomic_load_n(&store.committed, __ATOMIC_SEQ_CST);
+        unsigned int expected = 0;
+        if (!__atomic_compare_exchange_n(&store.readers[i], &expected, (unsigned int)(committed >> 32), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) continue;
+        // A writer collecting garbage before the entry was set may have missed it, so move up to a version it has seen
+        uint64_t latest;
+        while ((latest = __atomic_load_n(&store.committed, __ATOMIC_SEQ_CST)) != committed) {
+            committed = latest;
+            __atomic_store_n(&store.readers[i], (unsigned int)(committed >> 32), __ATOMIC_SEQ_CST);
+        }
+        reader->entry = i;
+        reader->version = (unsigned int)(committed >> 32);
+        reader->count = (int)(unsigned int)committed;
+        return 1;
+    }
+    return 0;
+}
+
+// Give up snapshot, letting writers release what only it was using
+void store_read_end(STORE_READER* reader) {
+    __atomic_store_n(&store.readers[reader->entry], 0, __ATOMIC_SEQ_CST);
+}
+
+// Copy node as it was in the snapshot of reader without locking, returns 0 if the node is not part of the snapshot
+int store_read_node(const STORE_READER* reader, const STUDENT_NODE* node, STUDENT_NODE* copy) {
+    while (1) { // Retry until the copy does not overlap a writer changing the node
+        unsigned int before = __atomic_load_n(&node->write_seq, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+        memcpy(copy, node, sizeof(STUDENT_NODE));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&node->write_seq, __ATOMIC_RELAXED) == before) break;
+    }
+    if (copy->created_version > reader->version) return 0; // Inserted after the snapshot (or slot being reused)
+    if (copy->deleted_version && copy->deleted_version <= reader->version) return 0;
+    if (copy->fields_version > reader->version) { // Updated after the snapshot, use the values the snapshot saw
+        const RECORD_VERSION* version = copy->older;
+        while (version->fields_version > reader->version) version = version->older;
+        strcpy(copy->name, version->name);
+        copy->programme_code = version->programme_code;
+        copy->grade = version->grade;
+        copy->marks = version->marks;
+    }
+    return 1;
+}
+
+// Compare packed seq << 32 | slot entries
+static int compare_u64(const void* a, const void* b) {
+    uint64_t value_a = *(const uint64_t*)a;
+    uint64_t value_b = *(const uint64_t*)b;
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+// Fill slots (room for reader->count entries) with the slots of nodes in the snapshot of reader in list order
+// Scans the record table instead of the linked list, which writers change in place, returns number of slots
+int store_snapshot_slots(const STORE_READER* reader, int* slots) {
+    uint64_t* entries = malloc((reader->count + 1) * sizeof(uint64_t));
+    if (!entries) return 0;
+    int count = 0;
+    int segment_count = __atomic_load_n(&record_table.segment_count, __ATOMIC_ACQUIRE);
+    int used = __atomic_load_n(&record_table.used, __ATOMIC_ACQUIRE);
+    int base = 0;
+    for (int segment = 0; segment < segment_count && base < used; segment++) {
+        STUDENT_NODE* nodes = record_table.segments[segment].nodes;
+        int size = table_segment_size(segment);
+        for (int i = 0; i < size && base + i < used && count < reader->count; i++) {
+            STUDENT_NODE copy;
+            if (store_read_node(reader, &nodes[i], &copy)) entries[count++] = (uint64_t)copy.seq << 32 | (unsigned int)(base + i);
+        }
+        base += size;
+    }
+    qsort(entries, count, sizeof(uint64_t), compare_u64);
+    for (int i = 0; i < count; i++) slots[i] = (int)(unsigned int)entries[i];
+    free(entries);
+    return count;
+}
+
+// Shared state of the threads of the MVCC stress test
+typedef struct stress_state {
+    time_t deadline; // Threads stop once this time is reached
+    int programme_code;
+    long reads;
+    long writes;
+    long violations;
+    long failures; // Writes that ran out of memory
+    pthread_mutex_t lock; // Protects the totals above
+} STRESS_STATE;
+
+// Name written together with marks by stress writers, a torn read would show a name that does not match the marks
+static void stress_name(char* name, float marks) {
+    int tenths = marks_to_tenths(marks);
+    sprintf(name, "Stress %c%c%c", 'a' + tenths / 100, 'a' + tenths / 10 % 10, 'a' + tenths % 10);
+}
+
+// Next value of a thread's xorshift generator, rand is shared between threads
+static unsigned int stress_random(unsigned int* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Stress writer: insert, update and delete random records, one transaction each
+static void* stress_writer(void* arg) {
+    STRESS_STATE* state = arg;
+    unsigned int seed = (unsigned int)(uintptr_t)&seed | 1;
+    long writes = 0, failures = 0;
+    char name[MAX_NAME_LEN + 1];
+    while (time(NULL) < state->deadline) {
+        int operation = stress_random(&seed) % 3;
+        float marks = (stress_random(&seed) % 1001) / 10.0f;
+        stress_name(name, marks);
+        store_write_begin();
+        if (operation == 0 || node_count < STRESS_SEED_RECORDS / 2) { // Insert
+            int id = 1000000 + stress_random(&seed) % 9000000;
+            STUDENT_NODE* node;
+            if (!id_index_find(id) && (node = table_alloc_node())) {
+                node->id = id;
+                if (!update_node(node, name, programme_name(state->programme_code), marks) || !append_node(node)) {
+                    table_release_node(node);
+                    failures++;
+                }
+            }
+        }
+        else { // Update or delete a random live record
+            STUDENT_NODE* node = table_node(stress_random(&seed) % record_table.used);
+            if (node->deleted_version == 0 && id_index_find(node->id) == node) {
+                if (operation != 1) remove_node(node);
+                else if (!update_node(node, name, programme_name(state->programme_code), marks)) failures++;
+            }
+        }
+        store_write_end();
+        writes++;
+    }
+    pthread_mutex_lock(&state->lock);
+    state->writes += writes;
+    state->failures += failures;
+    pthread_mutex_unlock(&state->lock);
+    return NULL;
+}
+
+// Stress reader: take snapshots and check that each one holds its published record count, unique IDs and untorn records
+// and reads the same marks on both of its passes
+static void* stress_reader(void* arg) {
+    STRESS_STATE* state = arg;
+    unsigned char* seen = calloc(10000000 / 8, 1); // One bit per possible student ID
+    long reads = 0, violations = 0;
+    STORE_READER reader;
+    char name[MAX_NAME_LEN + 1];
+    while (seen && time(NULL) < state->deadline) {
+        if (!store_read_begin(&reader)) continue;
+        int count = 0;
+        long marks_sum[2] = { 0, 0 };
+        int segment_count = __atomic_load_n(&record_table.segment_count, __ATOMIC_ACQUIRE);
+        int used = __atomic_load_n(&record_table.used, __ATOMIC_ACQUIRE);
+        for (int pass = 0; pass < 2; pass++) { // Second pass clears the seen bits set by the first
+            int base = 0;
+            for (int segment = 0; segment < segment_count && base < used; segment++) {
+                STUDENT_NODE* nodes = record_table.segments[segment].nodes;
+                for (int i = 0; i < table_segment_size(segment) && base + i < used; i++) {
+                    STUDENT_NODE copy;
+                    if (!store_read_node(&reader, &nodes[i], &copy)) continue;
+                    marks_sum[pass] += marks_to_tenths(copy.marks);
+                    if (pass == 1) {
+                        seen[copy.id / 8] &= ~(1 << copy.id % 8);
+                        continue;
+                    }
+                    count++;
+                    if (seen[copy.id / 8] & (1 << copy.id % 8)) violations++; // Duplicate ID
+                    seen[copy.id / 8] |= 1 << copy.id % 8;
+                    stress_name(name, copy.marks);
+                    if (strcmp(name, copy.name) != 0 || copy.grade != calculate_grade_code(copy.marks)) violations++; // Torn record
+                }
+                base += table_segment_size(segment);
+            }
+        }
+        if (count != reader.count || marks_sum[0] != marks_sum[1]) violations++;
+        store_read_end(&reader);
+        reads++;
+    }
+    free(seen);
+    pthread_mutex_lock(&state->lock);
+    state->reads += reads;
+    state->violations += violations;
+    pthread_mutex_unlock(&state->lock);
+    return NULL;
+}
+
+// Run reader and writer threads against an in-memory store for some seconds, checking every snapshot read
+// Returns 0 if no invariant was violated and no write failed
+int run_stress_test(int reader_count, int writer_count, int seconds) {
+    if (reader_count > STORE_MAX_READERS) reader_count = STORE_MAX_READERS;
+    STRESS_STATE state = { 0, 0, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+    char name[MAX_NAME_LEN + 1];
+    srand(1);
+    store_write_begin();
+    id_index_init(STRESS_SEED_RECORDS);
+    state.programme_code = dict_intern(&programme_dict, "Stress Testing");
+    for (int i = 0; i < STRESS_SEED_RECORDS; i++) {
+        float marks = (rand() % 1001) / 10.0f;
+        STUDENT_NODE* node = table_alloc_node();
+        if (!node) break;
+        node->id = 1000000 + i * 7;
+        stress_name(name, marks);
+        if (!update_node(node, name, "Stress Testing", marks) || !append_node(node)) table_release_node(node);
+    }
+    store_write_end();
+
+    state.deadline = time(NULL) + seconds;
+    pthread_t* threads = malloc((reader_count + writer_count) * sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; threads && i < reader_count + writer_count; i++) {
+        if (pthread_create(&threads[i], NULL, i < reader_count ? stress_reader : stress_writer, &state) != 0) break;
+        started++;
+    }
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+
+    // Writer-side structures must agree once every thread has stopped
+    int listed = 0;
+    for (STUDENT_NODE* current = head; current; current = current->next) {
+        if (id_index_find(current->id) != current) state.violations++;
+        listed++;
+    }
+    if (listed != node_count || id_index_count() != node_count) state.violations++;
+    printf("CMS <STRESS>: %d readers took %ld snapshots, %d writers committed %ld transactions in %d seconds!\n",
+        reader_count, state.reads, writer_count, state.writes, seconds);
+    printf("CMS <STRESS>: %d records at end, %ld invariant violations, %ld failed writes!\n", node_count, state.violations, state.failures);
+    store_write_begin();
+    reset_list();
+    store_write_end();
+    return state.violations || state.failures ? 1 : 0;
+}
+
+// Invalidate cached lookups on field, called whenever records may match them differently
+void column_versions_bump(QUERY_FIELD field) {
+    column_versions[field]++;
+}
+
+// Fill matches with the nodes of a cached lookup of keyword on field in list order
+// Returns number of matches, or -1 on a miss (not cached, or its column changed since)
+int query_cache_find(QUERY_FIELD field, const char* keyword, STUDENT_NODE** matches) {
+    QUERY_CACHE_ENTRY* entry = query_cache.newest;
+    while (entry && (entry->field != field || strcmp(entry->keyword, keyword) != 0)) entry = entry->older;
+    if (entry && entry->version != column_versions[field]) { // Stale, a later lookup stores the fresh result
+        query_cache.invalidations++;
+        query_cache_drop(entry);
+        entry = NULL;
+    }
+    if (!entry) {
+        query_cache.misses++;
+        return -1;
+    }
+    for (int i = 0; i < entry->count; i++) {
+        matches[i] = id_index_find(entry->ids[i]); // Same records as when cached, records only come and go with a bump
+    }
+    if (entry != query_cache.newest) { // Move to front of least recently used order
+        entry->newer->older = entry->older;
+        if (entry->older) entry->older->newer = entry->newer;
+        else query_cache.oldest = entry->newer;
+        entry->newer = NULL;
+        entry->older = query_cache.newest;
+        query_cache.newest->newer = entry;
+        query_cache.newest = entry;
+    }
+    query_cache.hits++;
+    return entry->count;
+}
+
+// Remember IDs of matches of a lookup of keyword on field, evicting least recently used lookups beyond the cache bounds
+// Results too large for the cache, or without memory to hold them, are simply not cached
+void query_cache_store(QUERY_FIELD field, const char* keyword, STUDENT_NODE** matches, int count) {
+    size_t bytes = sizeof(QUERY_CACHE_ENTRY) + (size_t)count * sizeof(int);
+    if (bytes > QUERY_CACHE_MAX_BYTES) return;
+    QUERY_CACHE_ENTRY* entry = malloc(sizeof(QUERY_CACHE_ENTRY));
+    int* ids = malloc((count + 1) * sizeof(int));
+    if (!entry || !ids) {
+        free(entry);
+        free(ids);
+        return;
+    }
+    while (query_cache.oldest && (query_cache.count == QUERY_CACHE_ENTRIES || query_cache.bytes + bytes > QUERY_CACHE_MAX_BYTES)) {
+        query_cache.evictions++;
+        query_cache_drop(query_cache.oldest);
+    }
+    entry->field = field;
+    strcpy(entry->keyword, keyword);
+    entry->version = column_versions[field];
+    entry->ids = ids;
+    entry->count = count;
+    for (int i = 0; i < count; i++) {
+        ids[i] = matches[i]->id;
+    }
+    entry->newer = NULL;
+    entry->older = query_cache.newest;
+    if (query_cache.newest) query_cache.newest->newer = entry;
+    else query_cache.oldest = entry;
+    query_cache.newest = entry;
+    query_cache.count++;
+    query_cache.bytes += bytes;
+}
+
+// Unlink entry from the query cache and free it
+void query_cache_drop(QUERY_CACHE_ENTRY* entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else query_cache.newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else query_cache.oldest = entry->newer;
+    query_cache.count--;
+    query_cache.bytes -= sizeof(QUERY_CACHE_ENTRY) + (size_t)entry->count * sizeof(int);
+    free(entry->ids);
+    free(entry);
+}
+
+// Empty the query cache when its database is closed, counters start again for the next database
+void query_cache_free() {
+    while (query_cache.newest) query_cache_drop(query_cache.newest);
+    query_cache.hits = 0;
+    query_cache.misses = 0;
+    query_cache.invalidations = 0;
+    query_cache.evictions = 0;
+}
+
+// Write query cache usage and hit rate to file
+void write_cache_stats(FILE* file) {
+    long lookups = query_cache.hits + query_cache.misses;
+    fprintf(file, "\n============== QUERY CACHE =============\n");
+    fprintf(file, "%-22s %d of %d\n", "Lookups cached:", query_cache.count, QUERY_CACHE_ENTRIES);
+    fprintf(file, "%-22s %zu of %d\n", "Bytes used:", query_cache.bytes, QUERY_CACHE_MAX_BYTES);
+    fprintf(file, "%-22s %ld\n", "Hits:", query_cache.hits);
+    fprintf(file, "%-22s %ld\n", "Misses:", query_cache.misses);
+    fprintf(file, "%-22s %ld\n", "Invalidations:", query_cache.invalidations);
+    fprintf(file, "%-22s %ld\n", "Evictions:", query_cache.evictions);
+    fprintf(file, "%-22s %.1f%%\n", "Hit rate:", lookups ? 100.0 * query_cache.hits / lookups : 0.0);
+    fprintf(file, "========================================\n");
+    fprintf(file, "CMS <CACHE STATS>: %ld of %ld name and programme lookups answered from cache!\n", query_cache.hits, lookups);
+}